@@ -0,0 +1,1164 @@
+#include "variant"
+#include "shared_variant"
+#include "variant_dispatcher"
+#include "parallel_visit"
+#include "variant_channel"
+#include "variant_columns"
+#include "variant_span"
+#include "variant_reclaim"
+#include "variant_cow"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <string.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace se=std::experimental;
+
+std::atomic<size_t> allocations{0};
+
+template<typename T>
+struct CountingAllocator: std::allocator<T>{
+    template<typename U>
+    struct rebind{
+        typedef CountingAllocator<U> other;
+    };
+
+    CountingAllocator()=default;
+    template<typename U>
+    CountingAllocator(CountingAllocator<U> const&){}
+
+    T* allocate(size_t n){
+        allocations.fetch_add(1,std::memory_order_relaxed);
+        return std::allocator<T>::allocate(n);
+    }
+};
+
+typedef std::basic_string<char,std::char_traits<char>,CountingAllocator<char>>
+CountedString;
+
+// The same string type, but with its buffers retained when a variant
+// switches away from it.
+struct RetainedString: CountedString{
+    using CountedString::CountedString;
+    RetainedString()=default;
+};
+
+// An index whose destruction is deferred to a reclaimer thread.
+struct DeferredIndex{
+    std::map<int,int> nodes;
+};
+
+namespace std{ namespace experimental{
+template<>
+struct variant_dormant_buffer<RetainedString>:
+    variant_container_dormant_buffer<RetainedString>{};
+
+template<>
+struct variant_deferred_destruction<DeferredIndex>:
+    variant_reclaim_destruction<DeferredIndex>{};
+}}
+
+namespace{
+
+volatile long long sink;
+
+template<typename Func>
+void run_benchmark(char const* name,size_t count,Func func){
+    unsigned const repeats=10;
+    func();
+    auto const start=std::chrono::steady_clock::now();
+    for(unsigned i=0;i<repeats;++i)
+        func();
+    auto const end=std::chrono::steady_clock::now();
+    double const ns=
+        std::chrono::duration<double,std::nano>(end-start).count()/repeats;
+    std::cout<<name<<": "<<ns/count<<" ns/element"<<std::endl;
+}
+
+template<typename Variant>
+std::vector<Variant> make_mixed(size_t count){
+    std::vector<Variant> vec;
+    vec.reserve(count);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0,2);
+    for(size_t i=0;i<count;++i){
+        switch(dist(gen)){
+        case 0: vec.emplace_back(se::in_place<0>,int(i)); break;
+        case 1: vec.emplace_back(se::in_place<1>,double(i)); break;
+        default: vec.emplace_back(se::in_place<2>,short(i)); break;
+        }
+    }
+    return vec;
+}
+
+void index_scans(){
+    typedef se::variant<int,double,short> V;
+    size_t const count=1<<22;
+    std::vector<V> const vec=make_mixed<V>(count);
+
+    run_benchmark("count_if index()==1",count,[&]{
+        sink=std::count_if(vec.begin(),vec.end(),[](V const& v){
+            return v.index()==1;});
+    });
+    run_benchmark("count_alternative<1>",count,[&]{
+        sink=se::count_alternative<1>(vec.data(),vec.data()+vec.size());
+    });
+    run_benchmark("count_if holds_alternative<int|short>",count,[&]{
+        sink=std::count_if(vec.begin(),vec.end(),[](V const& v){
+            return se::holds_alternative<int>(v) ||
+                se::holds_alternative<short>(v);});
+    });
+    run_benchmark("count_if holds_any_of<int,short>",count,[&]{
+        sink=std::count_if(vec.begin(),vec.end(),[](V const& v){
+            return se::holds_any_of<int,short>(v);});
+    });
+
+    std::vector<V> work;
+    run_benchmark("std::partition index()==0",count,[&]{
+        work=vec;
+        sink=std::partition(work.begin(),work.end(),[](V const& v){
+            return v.index()==0;})-work.begin();
+    });
+    run_benchmark("partition_by_alternative<0>",count,[&]{
+        work=vec;
+        sink=se::partition_by_alternative<0>(work.begin(),work.end())-
+            work.begin();
+    });
+}
+
+typedef se::variant<int,double,short> Narrow;
+typedef se::variant<short,int,std::string,double> Wide;
+
+struct widen_visitor{
+    Wide operator()(int i) const{ return Wide(se::in_place<1>,i); }
+    Wide operator()(double d) const{ return Wide(se::in_place<3>,d); }
+    Wide operator()(short s) const{ return Wide(se::in_place<0>,s); }
+};
+
+void variant_casts(){
+    size_t const count=1<<20;
+    std::vector<Narrow> const vec=make_mixed<Narrow>(count);
+    std::vector<Wide> out(count);
+
+    run_benchmark("widen via visit",count,[&]{
+        for(size_t i=0;i<count;++i)
+            out[i]=se::visit(widen_visitor(),vec[i]);
+        sink=out[count/2].index();
+    });
+    run_benchmark("widen via variant_cast",count,[&]{
+        for(size_t i=0;i<count;++i)
+            out[i]=se::variant_cast<Wide>(vec[i]);
+        sink=out[count/2].index();
+    });
+    run_benchmark("cross-variant ==",count,[&]{
+        long long equal=0;
+        for(size_t i=0;i<count;++i)
+            equal+=(vec[i]==out[i]);
+        sink=equal;
+    });
+}
+
+
+struct StaticRoute{ int port; };
+struct WeightedRoute{ int ports[4]; int weights[4]; };
+typedef se::variant<StaticRoute,WeightedRoute> Route;
+
+struct route_port{
+    int operator()(StaticRoute const& r) const{ return r.port; }
+    int operator()(WeightedRoute const& r) const{ return r.ports[0]; }
+};
+
+template<typename Read,typename Write>
+void reader_scaling(char const* name,Read read,Write write){
+    unsigned const reads_per_thread=200000;
+    for(unsigned threads=1;threads<=64;threads*=2){
+        std::atomic<bool> done(false);
+        std::thread writer([&]{
+            int i=0;
+            while(!done.load()){
+                write(++i);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+        auto const start=std::chrono::steady_clock::now();
+        std::vector<std::thread> readers;
+        for(unsigned t=0;t<threads;++t){
+            readers.emplace_back([&]{
+                long long total=0;
+                for(unsigned i=0;i<reads_per_thread;++i)
+                    total+=read();
+                sink=total;
+            });
+        }
+        for(auto& t:readers)
+            t.join();
+        auto const end=std::chrono::steady_clock::now();
+        done=true;
+        writer.join();
+        double const ns=std::chrono::duration<double,std::nano>(end-start).count();
+        std::cout<<name<<" readers="<<threads<<": "
+                 <<(double(reads_per_thread)*threads)/ns*1000.0
+                 <<" Mreads/s"<<std::endl;
+    }
+}
+
+void shared_variant_readers(){
+    se::shared_variant<StaticRoute,WeightedRoute> sv(StaticRoute{80});
+    reader_scaling(
+        "shared_variant",
+        [&]{ return sv.visit(route_port()); },
+        [&](int i){
+            if(i%2)
+                sv.emplace<0>(StaticRoute{i});
+            else
+                sv.emplace<1>(WeightedRoute{{i,i,i,i},{1,1,1,1}});
+        });
+
+    std::shared_timed_mutex mutex;
+    Route route(StaticRoute{80});
+    reader_scaling(
+        "shared_timed_mutex",
+        [&]{
+            std::shared_lock<std::shared_timed_mutex> lock(mutex);
+            return se::visit(route_port(),route);
+        },
+        [&](int i){
+            std::lock_guard<std::shared_timed_mutex> lock(mutex);
+            route=StaticRoute{i};
+        });
+
+    std::shared_ptr<Route const> ptr=std::make_shared<Route const>(StaticRoute{80});
+    reader_scaling(
+        "atomic shared_ptr",
+        [&]{
+            std::shared_ptr<Route const> local=std::atomic_load(&ptr);
+            return se::visit(route_port(),*local);
+        },
+        [&](int i){
+            std::atomic_store(&ptr,std::make_shared<Route const>(StaticRoute{i}));
+        });
+}
+
+
+void mixed_destruction(){
+    typedef se::variant<int,double,std::string> V;
+    size_t const count=1<<20;
+    std::vector<typename std::aligned_storage<sizeof(V),alignof(V)>::type>
+        buffer(count);
+    V* const first=reinterpret_cast<V*>(buffer.data());
+
+    for(unsigned percent: {0u,10u,50u}){
+        std::string const name=
+            "construct+destroy_range "+std::to_string(percent)+"% strings";
+        run_benchmark(name.c_str(),count,[&]{
+            for(size_t i=0;i<count;++i){
+                if(i%100<percent)
+                    new(first+i) V(se::in_place<2>);
+                else if(i%2)
+                    new(first+i) V(se::in_place<0>,int(i));
+                else
+                    new(first+i) V(se::in_place<1>,double(i));
+            }
+            se::destroy_range(first,first+count);
+        });
+    }
+}
+
+
+struct Point{
+    double x,y,z;
+};
+
+void mixed_copies(){
+    typedef se::variant<int,double,Point,std::string> V;
+    size_t const count=1<<20;
+    std::vector<V> source;
+    source.reserve(count);
+    for(size_t i=0;i<count;++i){
+        switch(i%10){
+        case 0: source.emplace_back(se::in_place<3>,"str"); break;
+        case 1: case 2: case 3: source.emplace_back(se::in_place<2>); break;
+        case 4: case 5: case 6: source.emplace_back(se::in_place<1>,double(i)); break;
+        default: source.emplace_back(se::in_place<0>,int(i)); break;
+        }
+    }
+    std::vector<V> target(count);
+
+    run_benchmark("copy construct mixed array",count,[&]{
+        std::vector<V> copy(source);
+        sink=copy[count/2].index();
+    });
+    run_benchmark("copy assign mixed array",count,[&]{
+        for(size_t i=0;i<count;++i)
+            target[i]=source[(i+1)%count];
+        sink=target[count/2].index();
+    });
+    run_benchmark("move construct mixed array",count,[&]{
+        std::vector<V> copy(source);
+        std::vector<V> moved(std::make_move_iterator(copy.begin()),
+                             std::make_move_iterator(copy.end()));
+        sink=moved[count/2].index();
+    });
+}
+
+
+
+struct index_hash_visitor{
+    template<typename T>
+    size_t operator()(T const& t) const{ return std::hash<T>()(t); }
+};
+
+void bitwise_comparisons(){
+    typedef se::variant<long,unsigned long,long long> V;
+    size_t const count=1<<20;
+    std::vector<V> a;
+    a.reserve(count);
+    for(size_t i=0;i<count;++i){
+        switch(i%3){
+        case 0: a.emplace_back(se::in_place<0>,long(i)); break;
+        case 1: a.emplace_back(se::in_place<1>,(unsigned long)i); break;
+        default: a.emplace_back(se::in_place<2>,(long long)i); break;
+        }
+    }
+    std::vector<V> const b(a);
+
+    run_benchmark("== via visit",count,[&]{
+        long long equal=0;
+        for(size_t i=0;i<count;++i)
+            equal+=(a[i].index()==b[i].index()) &&
+                se::visit([&](auto const& x){
+                    return x==se::get<std::decay_t<decltype(x)>>(b[i]);},a[i]);
+        sink=equal;
+    });
+    run_benchmark("== bitwise",count,[&]{
+        long long equal=0;
+        for(size_t i=0;i<count;++i)
+            equal+=(a[i]==b[i]);
+        sink=equal;
+    });
+    run_benchmark("hash via visit",count,[&]{
+        size_t total=0;
+        for(size_t i=0;i<count;++i)
+            total+=a[i].index()^se::visit(index_hash_visitor(),a[i]);
+        sink=total;
+    });
+    run_benchmark("std::hash bitwise",count,[&]{
+        size_t total=0;
+        for(size_t i=0;i<count;++i)
+            total+=std::hash<V>()(a[i]);
+        sink=total;
+    });
+    run_benchmark("std::equal",count,[&]{
+        sink=std::equal(a.begin(),a.end(),b.begin());
+    });
+    run_benchmark("equal_ranges",count,[&]{
+        sink=se::equal_ranges(a.data(),a.data()+count,b.data());
+    });
+}
+
+
+
+typedef std::chrono::steady_clock::time_point Stamp;
+struct OrderNew{ Stamp sent; long id; double price; };
+struct OrderCancel{ Stamp sent; long id; };
+struct Fill{ Stamp sent; long id; long quantity; };
+typedef se::variant<OrderNew,OrderCancel,Fill> Event;
+
+struct latency_stats{
+    std::mutex mutex;
+    std::vector<double> samples;
+
+    template<typename T>
+    void record(T* first,T* last){
+        auto const now=std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lk(mutex);
+        for(;first!=last;++first)
+            samples.push_back(
+                std::chrono::duration<double,std::micro>(now-first->sent).count());
+    }
+
+    void report(char const* name,double seconds,size_t events){
+        std::sort(samples.begin(),samples.end());
+        std::cout<<name<<": "<<events/seconds/1e6<<" Mevents/s, latency p50="
+                 <<samples[samples.size()/2]<<"us p99="
+                 <<samples[samples.size()*99/100]<<"us"<<std::endl;
+    }
+};
+
+Event make_event(unsigned i){
+    Stamp const now=std::chrono::steady_clock::now();
+    switch(i%4){
+    case 0: return Event(OrderCancel{now,long(i)});
+    case 1: return Event(Fill{now,long(i),10});
+    default: return Event(OrderNew{now,long(i),1.5});
+    }
+}
+
+template<typename Push>
+double produce(unsigned producers,unsigned per_producer,Push push){
+    auto const start=std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for(unsigned p=0;p<producers;++p){
+        threads.emplace_back([&]{
+            for(unsigned i=0;i<per_producer;++i)
+                push(make_event(i));
+        });
+    }
+    for(auto& t:threads)
+        t.join();
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now()-start).count();
+}
+
+// The hand-written alternative: a visit that pushes onto one
+// mutex-protected queue per alternative, each drained by its own thread.
+template<typename T>
+struct locked_queue{
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<T> items;
+    bool done=false;
+
+    void push(T t){
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            items.push_back(std::move(t));
+        }
+        ready.notify_one();
+    }
+
+    template<typename Handler>
+    void run(Handler handler){
+        std::vector<T> batch;
+        for(;;){
+            {
+                std::unique_lock<std::mutex> lk(mutex);
+                ready.wait(lk,[&]{ return done || !items.empty(); });
+                if(items.empty())
+                    return;
+                while(!items.empty() && batch.size()<64){
+                    batch.push_back(std::move(items.front()));
+                    items.pop_front();
+                }
+            }
+            handler(batch.data(),batch.data()+batch.size());
+            batch.clear();
+        }
+    }
+
+    void finish(){
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            done=true;
+        }
+        ready.notify_all();
+    }
+};
+
+struct queue_router{
+    locked_queue<OrderNew>& news;
+    locked_queue<OrderCancel>& cancels;
+    locked_queue<Fill>& fills;
+    void operator()(OrderNew const& e) const{ news.push(e); }
+    void operator()(OrderCancel const& e) const{ cancels.push(e); }
+    void operator()(Fill const& e) const{ fills.push(e); }
+};
+
+void event_dispatch(){
+    unsigned const per_producer=200000;
+    for(unsigned producers: {1u,4u}){
+        size_t const events=size_t(producers)*per_producer;
+        {
+            latency_stats stats;
+            double seconds;
+            {
+                se::variant_dispatcher<OrderNew,OrderCancel,Fill>::options opts;
+                opts.threads=3;
+                se::variant_dispatcher<OrderNew,OrderCancel,Fill> d(
+                    opts,
+                    [&](OrderNew* f,OrderNew* l){ stats.record(f,l); },
+                    [&](OrderCancel* f,OrderCancel* l){ stats.record(f,l); },
+                    [&](Fill* f,Fill* l){ stats.record(f,l); });
+                seconds=produce(producers,per_producer,[&](Event&& e){
+                    d.push(std::move(e));});
+                d.stop();
+            }
+            std::string const name=
+                "variant_dispatcher producers="+std::to_string(producers);
+            stats.report(name.c_str(),seconds,events);
+        }
+        {
+            latency_stats stats;
+            locked_queue<OrderNew> news;
+            locked_queue<OrderCancel> cancels;
+            locked_queue<Fill> fills;
+            std::thread t1([&]{ news.run([&](OrderNew* f,OrderNew* l){ stats.record(f,l); }); });
+            std::thread t2([&]{ cancels.run([&](OrderCancel* f,OrderCancel* l){ stats.record(f,l); }); });
+            std::thread t3([&]{ fills.run([&](Fill* f,Fill* l){ stats.record(f,l); }); });
+            double const seconds=produce(producers,per_producer,[&](Event&& e){
+                se::visit(queue_router{news,cancels,fills},e);});
+            news.finish();
+            cancels.finish();
+            fills.finish();
+            t1.join();
+            t2.join();
+            t3.join();
+            std::string const name=
+                "visit+locked queues producers="+std::to_string(producers);
+            stats.report(name.c_str(),seconds,events);
+        }
+    }
+}
+
+
+
+struct as_double{
+    double operator()(int i) const{ return i; }
+    double operator()(double d) const{ return d; }
+    double operator()(short s) const{ return s*2.0; }
+};
+
+void parallel_visit_scaling(){
+    typedef se::variant<int,double,short> V;
+    size_t const count=1<<25;
+    std::vector<V> const vec=make_mixed<V>(count);
+    auto const plus=[](double a,double b){ return a+b; };
+
+    run_benchmark("sequential visit",count,[&]{
+        double total=0;
+        for(auto const& v:vec)
+            total+=se::visit(as_double(),v);
+        sink=(long long)total;
+    });
+    unsigned const cores=std::max(1u,std::thread::hardware_concurrency());
+    for(unsigned threads=1;;threads=std::min(threads*2,cores)){
+        se::parallel_visit_options opts;
+        opts.threads=threads;
+        std::string const name="parallel_visit threads="+std::to_string(threads);
+        run_benchmark(name.c_str(),count,[&]{
+            sink=(long long)se::parallel_visit(
+                vec.begin(),vec.end(),as_double(),plus,opts);
+        });
+        if(threads==cores)
+            break;
+    }
+}
+
+
+// Round trips between two processes over a pair of channels, so each
+// element is two one-way messages.
+void channel_ping_pong(){
+    typedef se::variant_channel<int,double> Channel;
+    std::string const base="/jss_variant_bench_"+std::to_string(getpid());
+    std::string const ping_name=base+"_ping",pong_name=base+"_pong";
+    Channel ping=Channel::create(ping_name.c_str(),64);
+    Channel pong=Channel::create(pong_name.c_str(),64);
+    pid_t const child=fork();
+    if(child==0){
+        Channel requests=Channel::attach(ping_name.c_str());
+        Channel replies=Channel::attach(pong_name.c_str());
+        bool done=false;
+        while(!done){
+            bool const got=requests.try_visit([&](auto value){
+                if(value<0)
+                    done=true;
+                else
+                    replies.emplace<1>(double(value));
+            });
+            if(!got)
+                sched_yield();
+        }
+        _exit(0);
+    }
+    size_t const count=100000;
+    run_benchmark("variant_channel round trip",count,[&]{
+        double total=0;
+        for(size_t i=0;i<count;++i){
+            ping.emplace<0>(int(i));
+            while(!pong.try_visit([&](auto value){ total+=value; }))
+                sched_yield();
+        }
+        sink=(long long)total;
+    });
+    ping.emplace<0>(-1);
+    waitpid(child,nullptr,0);
+    Channel::unlink(ping_name.c_str());
+    Channel::unlink(pong_name.c_str());
+}
+
+
+struct Reading{
+    uint32_t sensor;
+    float value;
+};
+
+// An event log with bursts of one kind of event, as columns and as
+// variant_span records.
+void columnar_encoding(){
+    typedef se::variant<int64_t,double,Reading,uint8_t> V;
+    size_t const count=1<<20;
+    std::vector<V> log;
+    log.reserve(count);
+    std::mt19937 gen(42);
+    int64_t timestamp=1500000000000;
+    while(log.size()<count){
+        size_t const burst=std::min<size_t>(1+gen()%32,count-log.size());
+        unsigned const kind=gen()%4;
+        for(size_t i=0;i<burst;++i){
+            switch(kind){
+            case 0: timestamp+=gen()%100; log.emplace_back(timestamp); break;
+            case 1: log.emplace_back(0.25*(gen()%16)); break;
+            case 2: log.emplace_back(Reading{uint32_t(gen()%1000),float(gen()%1000)}); break;
+            default: log.emplace_back(uint8_t(gen()%4)); break;
+            }
+        }
+    }
+    std::ostringstream row_out,column_out;
+    se::write_variant_span(row_out,log.begin(),log.end());
+    se::write_variant_columns(column_out,log.begin(),log.end());
+    std::string const row_bytes=row_out.str(),column_bytes=column_out.str();
+    std::vector<double> row_buffer(row_bytes.size()/sizeof(double)+1);
+    memcpy(row_buffer.data(),row_bytes.data(),row_bytes.size());
+    se::variant_span<int64_t,double,Reading,uint8_t> const rows(
+        row_buffer.data(),row_bytes.size());
+    se::variant_columns<int64_t,double,Reading,uint8_t> const columns(
+        column_bytes.data(),column_bytes.size());
+    std::cout<<"row-wise bytes/element: "<<double(row_bytes.size())/count<<std::endl;
+    std::cout<<"columnar bytes/element: "<<double(column_bytes.size())/count<<std::endl;
+
+    std::vector<V> out;
+    out.reserve(count);
+    run_benchmark("row-wise decode",count,[&]{
+        out.clear();
+        for(size_t i=0;i<rows.size();++i)
+            out.push_back(rows.load(i));
+        sink=(long long)out.size();
+    });
+    run_benchmark("columnar decode",count,[&]{
+        out.clear();
+        columns.decode(std::back_inserter(out));
+        sink=(long long)out.size();
+    });
+    run_benchmark("row-wise timestamps",count,[&]{
+        int64_t total=0;
+        for(size_t i=0;i<rows.size();++i)
+            if(rows.index(i)==0)
+                total+=rows.get<0>(i);
+        sink=total;
+    });
+    run_benchmark("columnar timestamps",count,[&]{
+        int64_t total=0;
+        for(int64_t t:columns.column<0>())
+            total+=t;
+        sink=total;
+    });
+}
+
+
+struct Order{
+    uint64_t id;
+    double prices[64];
+    uint32_t quantities[64];
+};
+
+Order make_order(uint64_t id){
+    Order order;
+    order.id=id;
+    for(unsigned i=0;i<64;++i){
+        order.prices[i]=double(id+i);
+        order.quantities[i]=uint32_t(id*i);
+    }
+    return order;
+}
+
+void factory_emplace(){
+    typedef se::variant<int,Order> V;
+    size_t const count=1<<18;
+    V v;
+    run_benchmark("emplace of factory result",count,[&]{
+        for(size_t i=0;i<count;++i){
+            v.emplace<1>(make_order(i));
+            sink=(long long)se::get<1>(v).quantities[i%64];
+        }
+    });
+    run_benchmark("emplace_with factory",count,[&]{
+        for(size_t i=0;i<count;++i){
+            v.emplace_with<1>([&]{ return make_order(i); });
+            sink=(long long)se::get<1>(v).quantities[i%64];
+        }
+    });
+}
+
+template<typename String>
+void switch_field_slots(char const* name){
+    typedef se::variant<String,int64_t,double> Field;
+    size_t const rows=1<<16;
+    size_t const fields=8;
+    std::vector<Field> row(fields);
+    char const text[]="a field value too long for the small buffer";
+    auto const parse=[&]{
+        for(size_t r=0;r<rows;++r){
+            for(size_t f=0;f<fields;++f){
+                if((r+f)%2)
+                    row[f]=int64_t(r);
+                else
+                    row[f]=text;
+            }
+            sink=(long long)row[r%fields].index();
+        }
+    };
+    run_benchmark(name,rows*fields,parse);
+    size_t const before=allocations.load(std::memory_order_relaxed);
+    parse();
+    size_t const made=allocations.load(std::memory_order_relaxed)-before;
+    std::cout<<name<<": "<<double(made)/(rows*fields)
+             <<" allocations/element"<<std::endl;
+}
+
+void dormant_buffers(){
+    switch_field_slots<CountedString>("string slot switching");
+    switch_field_slots<RetainedString>("retained string slot switching");
+}
+
+std::map<int,int>& nodes_of(std::map<int,int>& index){
+    return index;
+}
+
+std::map<int,int>& nodes_of(DeferredIndex& index){
+    return index.nodes;
+}
+
+template<typename Index>
+void replace_latencies(char const* name){
+    typedef se::variant<int64_t,Index> Slot;
+    size_t const ops=1<<15;
+    size_t const slots=16;
+    size_t const nodes=1024;
+    std::vector<Index> indexes(ops/32);
+    for(Index& index:indexes)
+        for(size_t i=0;i<nodes;++i)
+            nodes_of(index).emplace(int(i),int(i));
+    std::vector<Slot> table(slots);
+    std::vector<double> latencies;
+    latencies.reserve(ops);
+    for(size_t i=0;i<ops;++i){
+        auto const start=std::chrono::steady_clock::now();
+        if(i%32)
+            table[i%slots]=int64_t(i);
+        else
+            table[i%slots]=std::move(indexes[i/32]);
+        if((i%256)==255)
+            se::variant_reclaim_queue::local().hand_off();
+        auto const end=std::chrono::steady_clock::now();
+        latencies.push_back(std::chrono::duration<double,std::nano>(end-start).count());
+    }
+    std::sort(latencies.begin(),latencies.end());
+    std::cout<<name<<": p50 "<<latencies[ops/2]<<" ns, p99 "<<latencies[ops*99/100]
+             <<" ns, p999 "<<latencies[ops*999/1000]<<" ns, max "<<latencies.back()
+             <<" ns"<<std::endl;
+}
+
+void deferred_destruction(){
+    replace_latencies<std::map<int,int>>("replace inline destruction");
+    se::variant_reclaimer reclaimer;
+    replace_latencies<DeferredIndex>("replace deferred destruction");
+}
+
+struct SmallMsg{
+    int64_t sequence;
+    double price;
+};
+
+struct BigSnapshot{
+    std::string venue;
+    std::vector<double> bids;
+    std::vector<double> asks;
+};
+
+BigSnapshot make_snapshot(){
+    BigSnapshot snapshot;
+    snapshot.venue="XLON";
+    snapshot.bids.assign(1024,100.0);
+    snapshot.asks.assign(1024,100.5);
+    return snapshot;
+}
+
+template<typename Snapshot>
+void fan_out(char const* name){
+    typedef se::variant<SmallMsg,Snapshot> Message;
+    size_t const receivers=16;
+    size_t const messages=1<<10;
+    std::vector<Message> source;
+    for(size_t i=0;i<messages;++i){
+        if(i%4)
+            source.emplace_back(SmallMsg{int64_t(i),double(i)});
+        else
+            source.emplace_back(Snapshot(make_snapshot()));
+    }
+    std::vector<std::vector<Message>> inboxes(receivers);
+    run_benchmark(name,messages*receivers,[&]{
+        for(auto& inbox:inboxes)
+            inbox.clear();
+        for(Message const& message:source)
+            for(auto& inbox:inboxes)
+                inbox.push_back(message);
+        sink=(long long)inboxes.back().size();
+    });
+}
+
+void cow_fan_out(){
+    fan_out<BigSnapshot>("fan-out deep copies");
+    fan_out<se::cow<BigSnapshot>>("fan-out cow");
+    fan_out<se::cow<BigSnapshot,se::cow_single_thread>>("fan-out single-thread cow");
+}
+
+// A range in which each alternative is repeated for a run whose length
+// is drawn uniformly from 1 to 2*mean_run-1, so runs average mean_run.
+template<typename Variant>
+std::vector<Variant> make_runs(size_t count,size_t mean_run){
+    std::vector<Variant> vec;
+    vec.reserve(count);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<size_t> length(1,2*mean_run-1);
+    std::uniform_int_distribution<int> step(1,2);
+    int alternative=0;
+    while(vec.size()<count){
+        alternative=(alternative+step(gen))%3;
+        for(size_t i=length(gen);i && vec.size()<count;--i){
+            switch(alternative){
+            case 0: vec.emplace_back(se::in_place<0>,int(i)); break;
+            case 1: vec.emplace_back(se::in_place<1>,double(i)); break;
+            default: vec.emplace_back(se::in_place<2>,short(i)); break;
+            }
+        }
+    }
+    return vec;
+}
+
+struct sum_visitor{
+    long long& total;
+    template<typename T>
+    void operator()(T const& value) const{
+        total+=(long long)value;
+    }
+};
+
+struct sum_run_visitor{
+    long long& total;
+    template<ptrdiff_t I,typename It>
+    void operator()(se::alternative_run<I,It> const& run) const{
+        long long sum=0;
+        for(auto const& value:run)
+            sum+=(long long)value;
+        total+=sum;
+    }
+};
+
+// The range is small enough to stay in cache so that the cost measured
+// is that of the dispatch rather than of memory bandwidth.
+void run_length_visitation(){
+    typedef se::variant<int,double,short> V;
+    size_t const count=1<<14;
+    unsigned const passes=256;
+    for(size_t mean_run:{1,4,16,64,256}){
+        std::vector<V> const vec=make_runs<V>(count,mean_run);
+        std::string const suffix=" (mean run "+std::to_string(mean_run)+")";
+        run_benchmark(("visit per element"+suffix).c_str(),count*passes,[&]{
+            long long total=0;
+            for(unsigned pass=0;pass<passes;++pass)
+                for(V const& v:vec)
+                    se::visit(sum_visitor{total},v);
+            sink=total;
+        });
+        run_benchmark(("visit_runs"+suffix).c_str(),count*passes,[&]{
+            long long total=0;
+            for(unsigned pass=0;pass<passes;++pass)
+                se::visit_runs(
+                    vec.data(),vec.data()+vec.size(),sum_run_visitor{total});
+            sink=total;
+        });
+    }
+}
+
+// Hardware counters for the calling thread, user space only. Each is
+// opened on its own so that those the machine provides still work when
+// others, such as L1i misses under some virtual machines, do not.
+class HardwareCounters{
+    struct Counter{
+        char const* name;
+        uint32_t type;
+        uint64_t config;
+        int fd;
+        uint64_t value;
+    };
+
+    std::vector<Counter> counters;
+    int open_errno=0;
+
+    static int open_counter(uint32_t type,uint64_t config){
+        perf_event_attr attr;
+        memset(&attr,0,sizeof(attr));
+        attr.size=sizeof(attr);
+        attr.type=type;
+        attr.config=config;
+        attr.disabled=1;
+        attr.exclude_kernel=1;
+        attr.exclude_hv=1;
+        return int(syscall(SYS_perf_event_open,&attr,0,-1,-1,0));
+    }
+
+public:
+    HardwareCounters():
+        counters{
+            {"instructions",PERF_TYPE_HARDWARE,PERF_COUNT_HW_INSTRUCTIONS,-1,0},
+            {"cycles",PERF_TYPE_HARDWARE,PERF_COUNT_HW_CPU_CYCLES,-1,0},
+            {"branch-misses",PERF_TYPE_HARDWARE,PERF_COUNT_HW_BRANCH_MISSES,-1,0},
+            {"L1i-misses",PERF_TYPE_HW_CACHE,
+             PERF_COUNT_HW_CACHE_L1I|(PERF_COUNT_HW_CACHE_OP_READ<<8)|
+             (PERF_COUNT_HW_CACHE_RESULT_MISS<<16),-1,0}}{
+        for(Counter& counter:counters){
+            counter.fd=open_counter(counter.type,counter.config);
+            if(counter.fd<0)
+                open_errno=errno;
+        }
+    }
+
+    HardwareCounters(HardwareCounters const&)=delete;
+    HardwareCounters& operator=(HardwareCounters const&)=delete;
+
+    ~HardwareCounters(){
+        for(Counter const& counter:counters)
+            if(counter.fd>=0)
+                close(counter.fd);
+    }
+
+    bool any() const{
+        return std::any_of(counters.begin(),counters.end(),
+                           [](Counter const& counter){ return counter.fd>=0;});
+    }
+
+    // Why the counters that are unavailable could not be opened.
+    char const* unavailable_reason() const{
+        return open_errno?strerror(open_errno):nullptr;
+    }
+
+    void start(){
+        for(Counter const& counter:counters)
+            if(counter.fd>=0){
+                ioctl(counter.fd,PERF_EVENT_IOC_RESET,0);
+                ioctl(counter.fd,PERF_EVENT_IOC_ENABLE,0);
+            }
+    }
+
+    void stop(){
+        for(Counter& counter:counters)
+            if(counter.fd>=0){
+                ioctl(counter.fd,PERF_EVENT_IOC_DISABLE,0);
+                if(read(counter.fd,&counter.value,sizeof(counter.value))!=
+                   sizeof(counter.value))
+                    counter.value=0;
+            }
+    }
+
+    void report(std::ostream& out,double operations) const{
+        for(Counter const& counter:counters){
+            out<<" "<<counter.name<<" ";
+            if(counter.fd>=0)
+                out<<double(counter.value)/operations;
+            else
+                out<<"n/a";
+        }
+    }
+};
+
+template<typename Func>
+void run_counted(HardwareCounters& counters,char const* name,size_t count,Func func){
+    unsigned const repeats=10;
+    func();
+    counters.start();
+    auto const start=std::chrono::steady_clock::now();
+    for(unsigned i=0;i<repeats;++i)
+        func();
+    auto const end=std::chrono::steady_clock::now();
+    counters.stop();
+    double const operations=double(count)*repeats;
+    std::cout<<name<<": "
+             <<std::chrono::duration<double,std::nano>(end-start).count()/operations
+             <<" ns";
+    counters.report(std::cout,operations);
+    std::cout<<" per operation"<<std::endl;
+}
+
+// Alternatives with user-provided copies, so that copies and moves are
+// dispatched through the op tables rather than copied as bytes.
+template<int N>
+struct Payload{
+    int value;
+
+    explicit Payload(int value_):
+        value(value_){}
+    Payload(Payload const& other):
+        value(other.value){}
+    Payload(Payload&& other) noexcept:
+        value(other.value){}
+    Payload& operator=(Payload const& other){
+        value=other.value;
+        return *this;
+    }
+
+    friend bool operator==(Payload const& lhs,Payload const& rhs){
+        return lhs.value==rhs.value;
+    }
+    friend bool operator<(Payload const& lhs,Payload const& rhs){
+        return lhs.value<rhs.value;
+    }
+};
+
+typedef se::variant<int,double,Payload<0>,Payload<1>,Payload<2>,Payload<3>>
+DispatchVariant;
+
+struct PayloadValue{
+    template<int N>
+    long long operator()(Payload<N> const& payload) const{
+        return payload.value+N;
+    }
+    long long operator()(int i) const{
+        return i;
+    }
+    long long operator()(double d) const{
+        return (long long)d;
+    }
+};
+
+struct PayloadPair{
+    template<typename First,typename Second>
+    long long operator()(First const& first,Second const& second) const{
+        return PayloadValue()(first)-PayloadValue()(second);
+    }
+};
+
+enum class TypeMix{ uniform,skewed,sorted };
+
+// uniform: every alternative equally likely, in random order. skewed:
+// nine in ten are Payload<0>. sorted: uniform, but grouped by index.
+std::vector<DispatchVariant> make_dispatch_mix(TypeMix mix,size_t count){
+    std::vector<DispatchVariant> vec;
+    vec.reserve(count);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0,5);
+    std::uniform_int_distribution<int> skew(0,9);
+    for(size_t i=0;i<count;++i){
+        int const index=((mix==TypeMix::skewed) && skew(gen))?2:dist(gen);
+        int const value=int(i%1000);
+        switch(index){
+        case 0: vec.emplace_back(se::in_place<0>,value); break;
+        case 1: vec.emplace_back(se::in_place<1>,double(value)); break;
+        case 2: vec.emplace_back(se::in_place<2>,value); break;
+        case 3: vec.emplace_back(se::in_place<3>,value); break;
+        case 4: vec.emplace_back(se::in_place<4>,value); break;
+        default: vec.emplace_back(se::in_place<5>,value); break;
+        }
+    }
+    if(mix==TypeMix::sorted)
+        std::stable_sort(vec.begin(),vec.end(),
+                         [](DispatchVariant const& lhs,DispatchVariant const& rhs){
+                             return lhs.index()<rhs.index();});
+    return vec;
+}
+
+void counted_dispatch(HardwareCounters& counters,char const* mix_name,TypeMix mix){
+    size_t const count=1<<20;
+    std::vector<DispatchVariant> const vec=make_dispatch_mix(mix,count);
+    std::vector<DispatchVariant> work(vec);
+    std::vector<DispatchVariant> other;
+    other.reserve(count);
+    std::string const prefix=std::string(mix_name)+" ";
+
+    run_counted(counters,(prefix+"visit").c_str(),count,[&]{
+        long long total=0;
+        for(DispatchVariant const& v:vec)
+            total+=se::visit(PayloadValue(),v);
+        sink=total;
+    });
+    run_counted(counters,(prefix+"multi-visit").c_str(),count-1,[&]{
+        long long total=0;
+        for(size_t i=0;i+1<count;++i)
+            total+=se::visit(PayloadPair(),vec[i],vec[i+1]);
+        sink=total;
+    });
+    run_counted(counters,(prefix+"copy").c_str(),count,[&]{
+        other.clear();
+        other.insert(other.end(),vec.begin(),vec.end());
+        sink=(long long)other.size();
+    });
+    run_counted(counters,(prefix+"move").c_str(),count,[&]{
+        other.clear();
+        other.insert(other.end(),std::make_move_iterator(work.begin()),
+                     std::make_move_iterator(work.end()));
+        work.swap(other);
+        sink=(long long)work.size();
+    });
+    run_counted(counters,(prefix+"equality").c_str(),count-1,[&]{
+        long long equal=0;
+        for(size_t i=0;i+1<count;++i)
+            equal+=(vec[i]==vec[i+1]);
+        sink=equal;
+    });
+    run_counted(counters,(prefix+"less-than").c_str(),count-1,[&]{
+        long long less=0;
+        for(size_t i=0;i+1<count;++i)
+            less+=(vec[i]<vec[i+1]);
+        sink=less;
+    });
+}
+
+void hardware_counter_dispatch(){
+    HardwareCounters counters;
+    if(!counters.any())
+        std::cout<<"hardware counters unavailable ("<<counters.unavailable_reason()
+                 <<"): reporting time only"<<std::endl;
+    counted_dispatch(counters,"uniform",TypeMix::uniform);
+    counted_dispatch(counters,"skewed",TypeMix::skewed);
+    counted_dispatch(counters,"sorted",TypeMix::sorted);
+}
+
+}
+
+int main(int argc,char* argv[]){
+    if((argc>1) && (std::string(argv[1])=="counters")){
+        hardware_counter_dispatch();
+        return 0;
+    }
+    index_scans();
+    variant_casts();
+    shared_variant_readers();
+    mixed_destruction();
+    mixed_copies();
+    bitwise_comparisons();
+    event_dispatch();
+    parallel_visit_scaling();
+    channel_ping_pong();
+    columnar_encoding();
+    factory_emplace();
+    dormant_buffers();
+    deferred_destruction();
+    cow_fan_out();
+    run_length_visitation();
+}
@@ -0,0 +1,173 @@
+// Binary size probe for the dispatch tables of variant: 60 variant
+// types of 3 to 6 alternatives, each copied, moved, assigned, swapped,
+// visited and compared with == and <. "make bloat" builds it as the
+// benchmarks are built and prints its section sizes with size(1), for
+// comparison before and after a change to the dispatch code.
+
+#include "variant"
+#include <string>
+#include <vector>
+
+namespace se=std::experimental;
+
+template<int N>
+struct Small{
+    int v[N%3+1];
+    bool operator==(Small const& o) const{ return v[0]==o.v[0]; }
+    bool operator<(Small const& o) const{ return v[0]<o.v[0]; }
+};
+
+template<int N>
+struct Big{
+    std::string s;
+    int n=N;
+    bool operator==(Big const& o) const{ return s==o.s; }
+    bool operator<(Big const& o) const{ return s<o.s; }
+};
+
+struct sizer{
+    template<typename T>
+    size_t operator()(T const& t) const{ return sizeof(t); }
+};
+
+volatile size_t sink;
+
+template<typename V>
+__attribute__((noinline)) void use(V& a,V& b){
+    V c(a);
+    V d(std::move(c));
+    a=b;
+    b=std::move(d);
+    swap(a,b);
+    sink=se::visit(sizer(),a)+(a==b)+(a<b);
+}
+
+#define BLOAT_PROBE(N,...)                      \
+    typedef se::variant<__VA_ARGS__> V##N;      \
+    template void use<V##N>(V##N&,V##N&)
+
+BLOAT_PROBE(0,Small<0>,double,char,std::string);
+BLOAT_PROBE(1,std::string,Big<1>,unsigned,short,double,int);
+BLOAT_PROBE(2,unsigned,Small<2>,int,std::string,char,short);
+BLOAT_PROBE(3,float,int,Big<3>);
+BLOAT_PROBE(4,unsigned,Big<4>,short);
+BLOAT_PROBE(5,int,std::vector<int>,short,std::string,float,Big<5>);
+BLOAT_PROBE(6,std::string,char,int,unsigned);
+BLOAT_PROBE(7,long,Big<7>,char);
+BLOAT_PROBE(8,float,std::vector<int>,unsigned);
+BLOAT_PROBE(9,char,Small<9>,std::string,std::vector<int>);
+BLOAT_PROBE(10,Small<10>,int,std::string,short,unsigned,Big<10>);
+BLOAT_PROBE(11,float,std::vector<int>,Big<11>,double);
+BLOAT_PROBE(12,Big<12>,std::vector<int>,double,long,unsigned,float);
+BLOAT_PROBE(13,int,std::string,char,Small<13>,unsigned,Big<13>);
+BLOAT_PROBE(14,long,std::vector<int>,short,int);
+BLOAT_PROBE(15,std::vector<int>,short,unsigned,float);
+BLOAT_PROBE(16,std::string,char,Big<16>,std::vector<int>,Small<16>);
+BLOAT_PROBE(17,unsigned,std::vector<int>,long);
+BLOAT_PROBE(18,unsigned,int,std::string,float);
+BLOAT_PROBE(19,std::vector<int>,unsigned,std::string,float);
+BLOAT_PROBE(20,float,int,std::vector<int>,Small<20>,std::string,short);
+BLOAT_PROBE(21,std::vector<int>,Small<21>,long,double);
+BLOAT_PROBE(22,int,Big<22>,double,std::string,char);
+BLOAT_PROBE(23,char,double,Small<23>,long);
+BLOAT_PROBE(24,char,double,long,std::vector<int>,Big<24>);
+BLOAT_PROBE(25,Big<25>,char,std::string,float,double);
+BLOAT_PROBE(26,char,unsigned,float);
+BLOAT_PROBE(27,short,char,double,std::vector<int>,Small<27>,unsigned);
+BLOAT_PROBE(28,short,int,unsigned);
+BLOAT_PROBE(29,int,long,std::string,std::vector<int>);
+BLOAT_PROBE(30,std::vector<int>,short,Big<30>,std::string,int,unsigned);
+BLOAT_PROBE(31,Big<31>,unsigned,int,char,long);
+BLOAT_PROBE(32,int,char,double,long);
+BLOAT_PROBE(33,Small<33>,char,long,int,std::vector<int>,short);
+BLOAT_PROBE(34,long,Small<34>,std::vector<int>,int,unsigned,short);
+BLOAT_PROBE(35,double,short,Small<35>,Big<35>,unsigned);
+BLOAT_PROBE(36,std::string,double,Big<36>,unsigned);
+BLOAT_PROBE(37,std::vector<int>,std::string,int,float,Small<37>);
+BLOAT_PROBE(38,char,int,long,short,float,Small<38>);
+BLOAT_PROBE(39,float,unsigned,short,char);
+BLOAT_PROBE(40,unsigned,std::vector<int>,float);
+BLOAT_PROBE(41,std::vector<int>,short,double,int,long,char);
+BLOAT_PROBE(42,Small<42>,std::vector<int>,char,float,double);
+BLOAT_PROBE(43,short,Small<43>,std::string,long,std::vector<int>);
+BLOAT_PROBE(44,float,int,unsigned);
+BLOAT_PROBE(45,unsigned,long,float);
+BLOAT_PROBE(46,Small<46>,unsigned,double);
+BLOAT_PROBE(47,Small<47>,double,char,float);
+BLOAT_PROBE(48,Small<48>,std::vector<int>,double,std::string,char);
+BLOAT_PROBE(49,int,char,Small<49>);
+BLOAT_PROBE(50,double,unsigned,int);
+BLOAT_PROBE(51,short,Small<51>,unsigned,long);
+BLOAT_PROBE(52,std::string,long,Big<52>);
+BLOAT_PROBE(53,long,double,unsigned,std::vector<int>);
+BLOAT_PROBE(54,std::vector<int>,char,std::string,float,double);
+BLOAT_PROBE(55,Big<55>,float,int,char);
+BLOAT_PROBE(56,std::string,unsigned,float,double,Small<56>);
+BLOAT_PROBE(57,double,char,short,Small<57>,std::vector<int>,std::string);
+BLOAT_PROBE(58,char,long,std::vector<int>,short,float);
+BLOAT_PROBE(59,char,double,std::string);
+
+#define BLOAT_CALL(N) { V##N a,b; use(a,b); }
+
+int main(){
+    BLOAT_CALL(0)
+    BLOAT_CALL(1)
+    BLOAT_CALL(2)
+    BLOAT_CALL(3)
+    BLOAT_CALL(4)
+    BLOAT_CALL(5)
+    BLOAT_CALL(6)
+    BLOAT_CALL(7)
+    BLOAT_CALL(8)
+    BLOAT_CALL(9)
+    BLOAT_CALL(10)
+    BLOAT_CALL(11)
+    BLOAT_CALL(12)
+    BLOAT_CALL(13)
+    BLOAT_CALL(14)
+    BLOAT_CALL(15)
+    BLOAT_CALL(16)
+    BLOAT_CALL(17)
+    BLOAT_CALL(18)
+    BLOAT_CALL(19)
+    BLOAT_CALL(20)
+    BLOAT_CALL(21)
+    BLOAT_CALL(22)
+    BLOAT_CALL(23)
+    BLOAT_CALL(24)
+    BLOAT_CALL(25)
+    BLOAT_CALL(26)
+    BLOAT_CALL(27)
+    BLOAT_CALL(28)
+    BLOAT_CALL(29)
+    BLOAT_CALL(30)
+    BLOAT_CALL(31)
+    BLOAT_CALL(32)
+    BLOAT_CALL(33)
+    BLOAT_CALL(34)
+    BLOAT_CALL(35)
+    BLOAT_CALL(36)
+    BLOAT_CALL(37)
+    BLOAT_CALL(38)
+    BLOAT_CALL(39)
+    BLOAT_CALL(40)
+    BLOAT_CALL(41)
+    BLOAT_CALL(42)
+    BLOAT_CALL(43)
+    BLOAT_CALL(44)
+    BLOAT_CALL(45)
+    BLOAT_CALL(46)
+    BLOAT_CALL(47)
+    BLOAT_CALL(48)
+    BLOAT_CALL(49)
+    BLOAT_CALL(50)
+    BLOAT_CALL(51)
+    BLOAT_CALL(52)
+    BLOAT_CALL(53)
+    BLOAT_CALL(54)
+    BLOAT_CALL(55)
+    BLOAT_CALL(56)
+    BLOAT_CALL(57)
+    BLOAT_CALL(58)
+    BLOAT_CALL(59)
+}
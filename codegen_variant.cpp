@@ -0,0 +1,60 @@
+// Probes for the code generated on the hot paths of variant. Each
+// probe is an extern "C" function so that it can be found by name in
+// the assembly; the "codegen:" comment above it lists the properties
+// check_codegen enforces on that function:
+//
+//   no-call             no call instructions at all
+//   no-indirect-call    no call through a register or memory operand
+//   no-throw            no call to a __throw function or __cxa_throw
+//   max-instructions=N  at most N instructions
+//
+// Run with "make codegen", or "make codegen CLANG=1" for clang.
+
+#include "variant"
+#include <string>
+
+namespace se=std::experimental;
+
+struct Point{
+    int x,y,z;
+};
+
+typedef se::variant<int,double,std::string> Mixed;
+typedef se::variant<int,double,Point> Trivial;
+
+struct square{
+    double operator()(int i) const{ return double(i)*i; }
+    double operator()(double d) const{ return d*d; }
+    double operator()(std::string const& s) const{ return double(s.size()); }
+};
+
+extern "C" {
+
+// codegen: no-indirect-call no-throw max-instructions=32
+int probe_get_after_emplace(Mixed& v,int i){
+    v.emplace<0>(i);
+    return se::get<0>(v);
+}
+
+// codegen: no-indirect-call no-throw max-instructions=16
+double probe_visit_known_index(double d){
+    Mixed v(se::in_place<1>,d);
+    return se::visit(square(),v);
+}
+
+// codegen: no-call max-instructions=12
+void probe_copy_trivial(Trivial* out,Trivial const& v){
+    new(out) Trivial(v);
+}
+
+// codegen: no-call max-instructions=4
+bool probe_holds_alternative(Mixed const& v){
+    return se::holds_alternative<double>(v);
+}
+
+// codegen: no-indirect-call max-instructions=48
+size_t probe_hash(se::variant<int,long> const& v){
+    return std::hash<se::variant<int,long>>()(v);
+}
+
+}
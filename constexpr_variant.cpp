@@ -0,0 +1,54 @@
+// Builds a 100,000 entry table of variants with emplace, assignment and
+// swap during constant evaluation, so that it is constant-initialized.
+// That takes about 30 million operations with g++ 12, just under its
+// default -fconstexpr-ops-limit of 2^25, and far more than the default
+// -fconstexpr-steps of 2^20 in clang, so "make constexpr" raises the
+// limit to 2^28. Tables of this size need the same flag.
+//
+// Run with "make constexpr", or "make constexpr CLANG=1" for clang.
+
+#include "variant"
+
+#ifndef _JSS_VARIANT_IS_CONSTANT_EVALUATED
+#error "Constant evaluation of emplace and assignment needs __builtin_is_constant_evaluated"
+#endif
+
+namespace se=std::experimental;
+
+typedef se::variant<int,double,char> Entry;
+
+constexpr int table_size=100000;
+
+struct Table{
+    Entry entries[table_size];
+
+    constexpr Table():
+        entries{}
+    {
+        for(int i=0;i<table_size;++i){
+            switch(i%3){
+            case 0: entries[i].emplace<0>(i); break;
+            case 1: entries[i].emplace<1>(i*0.5); break;
+            default: entries[i].emplace<char>(char('a'+i%26)); break;
+            }
+        }
+        Entry first=entries[0];
+        first=entries[2];
+        entries[0].swap(entries[1]);
+        entries[table_size-1]=first;
+    }
+};
+
+constexpr Table table{};
+
+static_assert(table.entries[0].index()==1,"");
+static_assert(se::get<0>(table.entries[1])==0,"");
+static_assert(se::get<0>(table.entries[99996])==99996,"");
+static_assert(table.entries[table_size-1]==Entry('c'),"");
+
+int main(){
+    int count=0;
+    for(Entry const& entry:table.entries)
+        count+=(entry.index()==0);
+    return count!=33333;
+}
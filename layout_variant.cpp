@@ -0,0 +1,61 @@
+// Prints variant_layout_report for a list of variant types, for review
+// of new message variants. The types come from a header passed as
+// LAYOUT_TYPES, which includes their definitions and defines
+//
+//   #define VARIANT_LAYOUT_TYPES(X) X(Message) X(Command)
+//
+// Run with "make layout LAYOUT_TYPES=my_types.h"; without it the
+// examples below are reported.
+
+#include "variant_layout"
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace se=std::experimental;
+
+#ifdef VARIANT_LAYOUT_TYPES_HEADER
+#include VARIANT_LAYOUT_TYPES_HEADER
+#else
+template<int N>
+struct ThrowingMove{
+    ThrowingMove(ThrowingMove&&){}
+};
+
+typedef se::variant<char,int,double> Numbers;
+typedef se::variant<int,std::string,std::vector<int>> Owning;
+typedef se::variant<ThrowingMove<0>,ThrowingMove<1>,std::string> NeedsBackup;
+
+#define VARIANT_LAYOUT_TYPES(X) X(Numbers) X(Owning) X(NeedsBackup)
+#endif
+
+template<typename Variant>
+void print_layout(char const* name){
+    typedef se::variant_layout_report<Variant> report;
+    std::cout<<name<<": size "<<report::size
+             <<", alignment "<<report::alignment
+             <<", storage "<<report::storage_size
+             <<", discriminator "<<report::discriminator_size
+             <<", padding "<<report::padding<<"\n";
+    std::cout<<"  backup storage required: "
+             <<(report::backup_storage_required?"yes":"no")
+             <<", nothrow move construct: "
+             <<(report::nothrow_move_constructible?"yes":"no")
+             <<", nothrow move assign: "
+             <<(report::nothrow_move_assignable?"yes":"no")<<"\n";
+    for(size_t i=0;i<report::alternatives;++i){
+        std::cout<<"  "<<i<<": size "<<report::alternative_size[i]
+                 <<", alignment "<<report::alternative_alignment[i]
+                 <<(report::trivially_copyable[i]?", trivially copyable":"")
+                 <<(report::trivially_destructible[i]?", trivially destructible":"")
+                 <<(report::alternative_nothrow_move_constructible[i]?
+                    "":", move may throw")
+                 <<(i==report::largest_alternative()?", largest":"")<<"\n";
+    }
+}
+
+#define PRINT_VARIANT_LAYOUT(Variant) print_layout<Variant>(#Variant);
+
+int main(){
+    VARIANT_LAYOUT_TYPES(PRINT_VARIANT_LAYOUT)
+}
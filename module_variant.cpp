@@ -0,0 +1,32 @@
+// Imports the experimental jss.variant module rather than including the
+// header. g++ 12 needs <new> included before the import, and cannot yet
+// compile a std::string alternative here, so only scalar alternatives
+// are used.
+//
+// Run with "make module".
+
+#include <new>
+#include <cassert>
+#include <iostream>
+import jss.variant;
+
+namespace se=std::experimental;
+
+struct Doubler{
+    double operator()(int i) const{ return i*2; }
+    double operator()(double d) const{ return d*2; }
+};
+
+int main(){
+    se::variant<int,double> v(21);
+    assert(v.index()==0);
+    assert(se::visit(Doubler(),v)==42);
+    v=1.25;
+    assert(se::get<double>(v)==1.25);
+    assert(se::visit(Doubler(),v)==2.5);
+    se::variant<int,double> w(v);
+    assert(w==v);
+    w.emplace<0>(3);
+    assert(w<v);
+    std::cout<<"module_variant"<<std::endl;
+}
@@ -1,15 +1,62 @@
 #include "variant"
+#include "shared_variant"
+#include "variant_dispatcher"
+#include "parallel_visit"
+#include "variant_span"
+#include "variant_channel"
+#include "variant_columns"
+#include "variant_ref"
+#include "variant_reclaim"
+#include "variant_cow"
+#include "variant_layout"
 #include <assert.h>
 #include <string>
 #include <vector>
 #include <memory>
 #include <iostream>
+#include <sstream>
 #include <array>
 #include <tuple>
 #include <mutex>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <sys/wait.h>
 
 namespace se=std::experimental;
 
+JSS_VARIANT_EXTERN_TEMPLATE(long,std::string);
+
+struct Deferred{
+    std::shared_ptr<int> resource;
+};
+
+struct DeferredNode{
+    std::shared_ptr<int> resource;
+    std::unique_ptr<std::experimental::variant<int,DeferredNode>> child;
+};
+
+namespace std{ namespace experimental{
+template<>
+struct variant_dormant_buffer<std::vector<char>>:
+    variant_container_dormant_buffer<std::vector<char>>{};
+
+template<>
+struct variant_dormant_buffer<std::vector<unsigned char>>:
+    variant_container_dormant_buffer<std::vector<unsigned char>,16,64>{};
+
+template<>
+struct variant_deferred_destruction<Deferred>:
+    variant_reclaim_destruction<Deferred>{};
+
+template<>
+struct variant_deferred_destruction<DeferredNode>:
+    variant_reclaim_destruction<DeferredNode>{};
+}}
+
 void initial_is_first_type(){
     std::cout<<__FUNCTION__<<std::endl;
     se::variant<int> v;
@@ -1938,6 +1985,1459 @@ void allocator_move_constructor_no_allocator_arg_support(){
     assert(se::get<1>(v2).was_moved);
 }
 
+void count_and_find_alternative(){
+    std::cout<<__FUNCTION__<<std::endl;
+    std::vector<se::variant<int,double,std::string>> vec;
+    vec.push_back(1);
+    vec.push_back(2.0);
+    vec.push_back(std::string("three"));
+    vec.push_back(4);
+    vec.push_back(5.0);
+    vec.push_back(6);
+
+    assert(se::count_alternative<0>(vec.begin(),vec.end())==3);
+    assert(se::count_alternative<1>(vec.begin(),vec.end())==2);
+    assert(se::count_alternative<std::string>(vec.begin(),vec.end())==1);
+    assert(se::count_alternative<int>(vec.begin(),vec.begin())==0);
+
+    assert(se::find_alternative<1>(vec.begin(),vec.end())==vec.begin()+1);
+    assert(se::find_alternative<std::string>(vec.begin(),vec.end())==vec.begin()+2);
+    assert(se::find_alternative<2>(vec.begin()+3,vec.end())==vec.end());
+
+    se::variant<int,double,std::string> const* const data=vec.data();
+    assert(se::count_alternative<int>(data,data+vec.size())==3);
+}
+
+void partition_by_alternative(){
+    std::cout<<__FUNCTION__<<std::endl;
+    std::vector<se::variant<int,std::string>> vec;
+    vec.push_back(std::string("a"));
+    vec.push_back(1);
+    vec.push_back(std::string("b"));
+    vec.push_back(2);
+    vec.push_back(3);
+
+    auto mid=se::partition_by_alternative<int>(vec.begin(),vec.end());
+    assert(mid==vec.begin()+3);
+    for(auto it=vec.begin();it!=mid;++it)
+        assert(it->index()==0);
+    for(auto it=mid;it!=vec.end();++it)
+        assert(it->index()==1);
+    assert(se::get<0>(vec[0])+se::get<0>(vec[1])+se::get<0>(vec[2])==6);
+
+    assert(se::partition_by_alternative<1>(vec.begin(),vec.begin())==vec.begin());
+}
+
+void holds_any_of(){
+    std::cout<<__FUNCTION__<<std::endl;
+    se::variant<int,double,std::string,char> v(2.0);
+    assert((se::holds_any_of<int,double>(v)));
+    assert((!se::holds_any_of<int,std::string>(v)));
+    assert((!se::holds_any_of<>(v)));
+    v=std::string("x");
+    assert((se::holds_any_of<char,std::string>(v)));
+
+    constexpr se::variant<int,double> vc(42);
+    static_assert(se::holds_any_of<int>(vc),"");
+    static_assert(!se::holds_any_of<double>(vc),"");
+    static_assert(noexcept(se::holds_any_of<int>(vc)),"");
+}
+
+void variant_cast_widening(){
+    std::cout<<__FUNCTION__<<std::endl;
+    se::variant<int,std::string> v(std::string("hello"));
+    auto w=se::variant_cast<se::variant<double,std::string,int>>(v);
+    static_assert(std::is_same<decltype(w),se::variant<double,std::string,int>>::value,"");
+    assert(w.index()==1);
+    assert(se::get<std::string>(w)=="hello");
+    assert(se::get<std::string>(v)=="hello");
+
+    se::variant<int,std::string> v2(42);
+    auto w2=se::variant_cast<se::variant<double,std::string,int>>(std::move(v2));
+    assert(w2.index()==2);
+    assert(se::get<int>(w2)==42);
+
+    se::variant<std::unique_ptr<int>,int> vp(std::unique_ptr<int>(new int(3)));
+    auto wp=se::variant_cast<se::variant<int,std::unique_ptr<int>>>(std::move(vp));
+    assert(wp.index()==1);
+    assert(*se::get<1>(wp)==3);
+    assert(vp.valueless_by_exception());
+}
+
+void try_variant_cast_narrowing(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant<int,std::string,double> Wide;
+    typedef se::variant<std::string,double> Narrow;
+
+    Wide v(std::string("hello"));
+    se::variant_cast_result<Narrow> n=se::try_variant_cast<Narrow>(v);
+    assert(n.converted);
+    assert(n);
+    assert(n.value.index()==0);
+    assert(se::get<std::string>(n.value)=="hello");
+
+    Wide vi(42);
+    auto ni=se::try_variant_cast<Narrow>(std::move(vi));
+    assert(!ni);
+    assert(ni.value.valueless_by_exception());
+    assert(vi.index()==0);
+    assert(se::get<int>(vi)==42);
+
+    Wide vd(1.5);
+    auto nd=se::try_variant_cast<Narrow>(std::move(vd));
+    assert(nd.converted);
+    assert(nd.value.index()==1);
+    assert(se::get<double>(nd.value)==1.5);
+
+    Wide empty(1);
+    Wide taken(std::move(empty));
+    assert(empty.valueless_by_exception());
+    auto ne=se::try_variant_cast<Narrow>(empty);
+    assert(ne.converted);
+    assert(ne.value.valueless_by_exception());
+}
+
+void cross_variant_equality(){
+    std::cout<<__FUNCTION__<<std::endl;
+    se::variant<int,std::string> a(42);
+    se::variant<std::string,double,int> b(42);
+    se::variant<std::string,double,int> c(43);
+    se::variant<std::string,double,int> d(4.2);
+    assert(a==b);
+    assert(b==a);
+    assert(a!=c);
+    assert(a!=d);
+    assert(d!=a);
+
+    a=std::string("x");
+    b=std::string("x");
+    assert(a==b);
+
+    constexpr se::variant<int,char> ci(42);
+    constexpr se::variant<char,int> ci2(42);
+    static_assert(ci==ci2,"");
+    static_assert(!(ci!=ci2),"");
+
+    // Variants of the same type may still repeat an alternative.
+    se::variant<int,int> e(se::in_place<1>,42);
+    se::variant<int,int> f(se::in_place<0>,42);
+    assert(e!=f);
+
+    // A repeated alternative would make the result depend on the order
+    // of the operands, so comparing e with a fails to compile: "no type
+    // may occur more than once in either".
+}
+
+struct IndexRecorder{
+    size_t& index;
+    template<size_t I,typename T>
+    void operator()(std::integral_constant<size_t,I>,T&){
+        index=I;
+    }
+};
+
+struct ReemplaceVisitor{
+    se::variant<int,int,std::string>& target;
+    template<size_t I,typename T>
+    void operator()(std::integral_constant<size_t,I>,T const& value){
+        target.emplace<I>(value);
+    }
+};
+
+struct IndexSum{
+    template<size_t I,typename T,size_t J,typename U>
+    constexpr size_t operator()(
+        std::integral_constant<size_t,I>,T,std::integral_constant<size_t,J>,U){
+        return I*10+J;
+    }
+};
+
+void visit_indexed(){
+    std::cout<<__FUNCTION__<<std::endl;
+    size_t index=99;
+    se::variant<int,int,std::string> v(se::in_place<1>,42);
+    se::visit_indexed(IndexRecorder{index},v);
+    assert(index==1);
+
+    se::variant<int,int,std::string> target;
+    se::visit_indexed(ReemplaceVisitor{target},
+                      static_cast<se::variant<int,int,std::string> const&>(v));
+    assert(target.index()==1);
+    assert(se::get<1>(target)==42);
+
+    v=std::string("hello");
+    se::visit_indexed(ReemplaceVisitor{target},std::move(v));
+    assert(target.index()==2);
+    assert(se::get<2>(target)=="hello");
+
+    constexpr se::variant<int,double> vi(42);
+    constexpr se::variant<int,double> vd(4.2);
+    static_assert(se::visit_indexed(IndexSum(),vi,vd)==1,"");
+    static_assert(se::visit_indexed(IndexSum(),vd,vi)==10,"");
+}
+
+struct ToLong{
+    int operator()(int i) const{ return i; }
+    short operator()(short s) const{ return s; }
+    char operator()(char c) const{ return c; }
+};
+
+void visit_with_explicit_return_type(){
+    std::cout<<__FUNCTION__<<std::endl;
+    se::variant<int,short,char> v(short(3));
+    auto r=se::visit<long>(ToLong(),v);
+    static_assert(std::is_same<decltype(r),long>::value,"");
+    assert(r==3);
+
+    se::variant<int,short,char> const cv('a');
+    assert(se::visit<long>(ToLong(),cv)=='a');
+    assert(se::visit<long>(ToLong(),std::move(v))==3);
+
+    int calls=0;
+    auto counter=[&](auto){ ++calls; return 1; };
+    se::visit<void>(counter,cv);
+    assert(calls==1);
+    auto pair_counter=[&](auto,auto){ ++calls; return 1; };
+    se::visit<void>(pair_counter,cv,v);
+    assert(calls==2);
+    static_assert(
+        std::is_same<decltype(se::visit<void>(pair_counter,cv,v)),void>::value,"");
+
+    constexpr se::variant<int,double> vi(42);
+    constexpr se::variant<int,double> vi2(21);
+    static_assert(se::visit<long>(Sum(),vi,vi2)==63,"");
+    static_assert(std::is_same<decltype(se::visit<long>(Sum(),vi,vi2)),long>::value,"");
+}
+
+void shared_variant_load_and_store(){
+    std::cout<<__FUNCTION__<<std::endl;
+    se::shared_variant<int,std::string> sv;
+    assert(sv.load()->index()==0);
+    assert(se::get<0>(*sv.load())==0);
+
+    {
+        auto handle=sv.load();
+        sv.store(std::string("hello"));
+        assert(se::get<0>(*handle)==0);
+        assert(se::get<1>(*sv.load())=="hello");
+    }
+
+    sv.emplace<0>(42);
+    assert(se::get<int>(sv.snapshot())==42);
+    sv.emplace<std::string>(3,'x');
+    assert(sv.visit([](auto const& x){ return sizeof(x)==sizeof(int); })==false);
+    assert(se::get<std::string>(sv.snapshot())=="xxx");
+
+    se::shared_variant<int,std::string> sv2(std::string("abc"));
+    assert(se::get<1>(*sv2.load())=="abc");
+}
+
+void shared_variant_concurrent_readers(){
+    std::cout<<__FUNCTION__<<std::endl;
+    se::shared_variant<int,std::string> sv(std::string("0"));
+    std::atomic<bool> done(false);
+    std::atomic<unsigned> reads(0);
+
+    std::vector<std::thread> readers;
+    for(unsigned i=0;i<4;++i){
+        readers.emplace_back([&]{
+            while(!done.load()){
+                auto handle=sv.load();
+                if(handle->index()==1){
+                    std::string const& s=se::get<1>(*handle);
+                    assert(!s.empty());
+                }
+                else{
+                    assert(se::get<0>(*handle)>=0);
+                }
+                ++reads;
+            }
+        });
+    }
+    while(reads.load()<100)
+        std::this_thread::yield();
+    for(int i=1;i<2000;++i){
+        if(i%2)
+            sv.emplace<0>(i);
+        else
+            sv.store(std::string(64,'a'+i%26));
+    }
+    done=true;
+    for(auto& t:readers)
+        t.join();
+}
+
+struct DestroyCounter{
+    static unsigned destroyed;
+    ~DestroyCounter(){ ++destroyed; }
+};
+unsigned DestroyCounter::destroyed=0;
+
+void destroy_range(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant<int,DestroyCounter,double> V;
+    typename std::aligned_storage<sizeof(V),alignof(V)>::type buffer[5];
+    V* const first=reinterpret_cast<V*>(buffer);
+    new(first) V(1);
+    new(first+1) V(se::in_place<1>);
+    new(first+2) V(2.0);
+    new(first+3) V(se::in_place<1>);
+    new(first+4) V(3);
+    DestroyCounter::destroyed=0;
+    se::destroy_range(first,first+5);
+    assert(DestroyCounter::destroyed==2);
+
+    typedef se::variant<int,double> T;
+    static_assert(std::is_trivially_destructible<T>::value,"");
+    T trivial[2]={T(1),T(2.0)};
+    se::destroy_range(trivial,trivial+2);
+
+    V v(se::in_place<1>);
+    DestroyCounter::destroyed=0;
+    v=42;
+    assert(DestroyCounter::destroyed==1);
+    v=1.5;
+    assert(DestroyCounter::destroyed==1);
+    assert(v.index()==2);
+}
+
+struct Point{
+    int x,y,z;
+};
+
+void trivial_alternatives_copied_bitwise(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant<int,Point,std::string> V;
+    V v(Point{1,2,3});
+    V copy(v);
+    assert(copy.index()==1);
+    assert(se::get<1>(copy).z==3);
+
+    V moved(std::move(copy));
+    assert(moved.index()==1);
+    assert(se::get<1>(moved).y==2);
+    assert(copy.valueless_by_exception());
+
+    V target(std::string("a string long enough to need an allocation"));
+    target=v;
+    assert(target.index()==1);
+    assert(se::get<1>(target).x==1);
+
+    target=std::string("another string long enough to need an allocation");
+    target=std::move(moved);
+    assert(target.index()==1);
+    assert(se::get<1>(target).y==2);
+    assert(moved.valueless_by_exception());
+
+    target=target;
+    assert(target.index()==1);
+    assert(se::get<1>(target).x==1);
+
+    int i=42;
+    se::variant<std::string,int&> ref(se::in_place<1>,i);
+    se::variant<std::string,int&> ref_copy(ref);
+    assert(&se::get<1>(ref_copy)==&i);
+
+    V s(std::string("hello"));
+    target=s;
+    assert(se::get<2>(target)=="hello");
+    target=V(7);
+    assert(se::get<0>(target)==7);
+}
+
+struct PackedKey{
+    int a;
+    int b;
+};
+
+bool operator==(PackedKey const& lhs,PackedKey const& rhs){
+    return lhs.a==rhs.a && lhs.b==rhs.b;
+}
+
+// Shades of one colour compare equal, and hash alike.
+enum class Shade{red,crimson,blue};
+
+bool is_red(Shade s){
+    return static_cast<int>(s)!=static_cast<int>(Shade::blue);
+}
+
+bool operator==(Shade lhs,Shade rhs){
+    return is_red(lhs)==is_red(rhs);
+}
+
+bool operator!=(Shade lhs,Shade rhs){
+    return is_red(lhs)!=is_red(rhs);
+}
+
+namespace std{
+template<>
+struct hash<Shade>{
+    size_t operator()(Shade s) const{
+        return is_red(s);
+    }
+};
+}
+
+namespace std{ namespace experimental{
+template<>
+struct variant_bitwise_comparable<PackedKey>: std::true_type{};
+}}
+
+void bitwise_equality_and_hash(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant<int,unsigned,PackedKey,std::string> V;
+    V v1(se::in_place<0>,42);
+    V v2(se::in_place<0>,42);
+    V v3(se::in_place<1>,42u);
+    V v4(se::in_place<2>,PackedKey{1,2});
+    V v5(se::in_place<2>,PackedKey{1,2});
+    V v6(se::in_place<2>,PackedKey{1,3});
+    V v7(se::in_place<3>,"hello");
+    V v8(se::in_place<3>,"hello");
+    assert(v1==v2);
+    assert(!(v1==v3));
+    assert(v1!=v3);
+    assert(v4==v5);
+    assert(v4!=v6);
+    assert(v7==v8);
+    std::hash<V> h;
+    assert(h(v1)==h(v2));
+    typedef se::variant<int,std::string> IS;
+    IS s1(se::in_place<1>,"a string too long for the small buffer");
+    IS s2(se::in_place<1>,"a string too long for the small buffer");
+    assert(std::hash<IS>()(s1)==std::hash<IS>()(s2));
+    assert(se::equal_ranges(&s1,&s1+1,&s2));
+    assert(h(v1)!=h(v3));
+    assert(h(v4)==h(v5));
+    assert(h(v7)==h(v8));
+
+    typedef se::variant<int,unsigned> D;
+    std::vector<D> a;
+    for(int i=0;i<200;++i){
+        if(i%3)
+            a.emplace_back(se::in_place<0>,i);
+        else
+            a.emplace_back(se::in_place<1>,unsigned(i));
+    }
+    std::vector<D> b(a);
+    assert(se::equal_ranges(a.data(),a.data()+a.size(),b.data()));
+    assert(se::equal_ranges(a.begin(),a.end(),b.begin()));
+    b[151]=D(se::in_place<1>,151u);
+    assert(!se::equal_ranges(a.data(),a.data()+a.size(),b.data()));
+    assert(!se::equal_ranges(a.begin(),a.end(),b.begin()));
+
+    static_assert(!se::variant_bitwise_comparable<Shade>::value,"");
+    typedef se::variant<int,Shade> S;
+    S red(Shade::red);
+    S crimson(Shade::crimson);
+    assert(red==crimson);
+    assert(red!=S(Shade::blue));
+    assert(std::hash<S>()(red)==std::hash<S>()(crimson));
+}
+
+void special_members_beyond_eight_alternatives(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant<
+        char,short,int,long,float,double,unsigned,bool,std::string,
+        std::vector<int>> V;
+    V v1(se::in_place<8>,"hello");
+    V v2(v1);
+    assert(se::get<8>(v2)=="hello");
+    V v3(se::in_place<9>,3,42);
+    V v4(std::move(v3));
+    assert(se::get<9>(v4).size()==3);
+    v2=v4;
+    assert(v2.index()==9);
+    assert(se::get<9>(v2)[2]==42);
+    v1=V(se::in_place<8>,"world");
+    assert(se::get<8>(v1)=="world");
+    v1=v1;
+    assert(se::get<8>(v1)=="world");
+    swap(v1,v2);
+    assert(se::get<8>(v2)=="world");
+    assert(se::get<9>(v1).size()==3);
+    V v5(se::in_place<9>,1,7);
+    swap(v1,v5);
+    assert(se::get<9>(v1).size()==1);
+    assert(se::get<9>(v5).size()==3);
+    v1=V(se::in_place<2>,5);
+    assert(se::get<2>(v1)==5);
+}
+
+void dispatcher_routes_by_alternative(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant_dispatcher<int,std::string,double> D;
+    std::atomic<long long> int_total(0);
+    std::atomic<unsigned> strings(0);
+    std::atomic<unsigned> doubles(0);
+    std::atomic<unsigned> largest_batch(0);
+    D::options opts;
+    opts.queue_capacity=16;
+    opts.max_batch=8;
+    opts.threads=2;
+    {
+        D d(opts,
+            [&](int* first,int* last){
+                unsigned const size=unsigned(last-first);
+                if(size>largest_batch)
+                    largest_batch=size;
+                for(;first!=last;++first)
+                    int_total+=*first;
+            },
+            [&](std::string* first,std::string* last){
+                for(;first!=last;++first){
+                    assert(*first=="hello");
+                    ++strings;
+                }
+            },
+            [&](double* first,double* last){
+                doubles+=unsigned(last-first);
+            });
+        std::vector<std::thread> producers;
+        for(int p=0;p<3;++p){
+            producers.emplace_back([&]{
+                for(int i=1;i<=1000;++i){
+                    d.push(se::variant<int,std::string,double>(i));
+                    if(i%10==0)
+                        d.push(se::variant<int,std::string,double>(std::string("hello")));
+                    if(i%100==0)
+                        d.push(se::variant<int,std::string,double>(1.5));
+                }
+            });
+        }
+        for(auto& t:producers)
+            t.join();
+        d.stop();
+    }
+    assert(int_total==3*500500);
+    assert(strings==300);
+    assert(doubles==30);
+    assert(largest_batch<=8);
+}
+
+void dispatcher_applies_backpressure(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant<int,double> V;
+    std::mutex gate;
+    std::unique_lock<std::mutex> closed(gate);
+    std::atomic<unsigned> handled(0);
+    se::variant_dispatcher<int,double>::options opts;
+    opts.queue_capacity=4;
+    opts.max_batch=1;
+    se::variant_dispatcher<int,double> d(
+        opts,
+        [&](int* first,int* last){
+            std::lock_guard<std::mutex> lk(gate);
+            handled+=unsigned(last-first);
+        },
+        [&](double*,double*){});
+    unsigned accepted=0;
+    while(d.try_push(V(1)))
+        ++accepted;
+    assert(accepted>=4);
+    assert(accepted<=5);
+    V rejected(42);
+    assert(!d.try_push(std::move(rejected)));
+    assert(se::get<0>(rejected)==42);
+    closed.unlock();
+    d.push(V(2));
+    d.stop();
+    assert(handled==accepted+1);
+}
+
+void dispatcher_skips_value_that_failed_to_copy(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant<int,ThrowingCopy> V;
+    std::atomic<int> total(0);
+    std::atomic<unsigned> throwing(0);
+    se::variant_dispatcher<int,ThrowingCopy>::options opts;
+    opts.queue_capacity=2;
+    se::variant_dispatcher<int,ThrowingCopy> d(
+        opts,
+        [&](int* first,int* last){
+            for(;first!=last;++first)
+                total+=*first;
+        },
+        [&](ThrowingCopy* first,ThrowingCopy* last){
+            throwing+=unsigned(last-first);
+        });
+    V const bad(se::in_place<1>);
+    for(int i=0;i<3;++i){
+        try{
+            d.push(bad);
+            assert(!"copy should throw");
+        }
+        catch(CopyError const&){}
+    }
+    for(int i=1;i<=4;++i)
+        d.push(V(i));
+    d.stop();
+    assert(total==10);
+    assert(throwing==0);
+}
+
+struct weighted_value{
+    double operator()(int i) const{ return i*0.5; }
+    double operator()(double d) const{ return d/3; }
+    double operator()(std::string const& s) const{ return double(s.size()); }
+};
+
+void parallel_visit_reduces_deterministically(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant<int,double,std::string> V;
+    std::vector<V> vec;
+    for(int i=0;i<100000;++i){
+        switch(i%3){
+        case 0: vec.emplace_back(i); break;
+        case 1: vec.emplace_back(i*1.1); break;
+        default: vec.emplace_back(std::string(size_t(i%7),'x')); break;
+        }
+    }
+    auto const plus=[](double a,double b){ return a+b; };
+    se::parallel_visit_options opts;
+    opts.chunk_size=1000;
+    opts.threads=1;
+    double const single=se::parallel_visit(
+        vec.begin(),vec.end(),weighted_value(),plus,opts);
+    double expected=0;
+    for(auto const& v:vec)
+        expected+=se::visit(weighted_value(),v);
+    assert(std::abs(single-expected)<1e-6*expected);
+    for(unsigned threads: {2u,3u,8u}){
+        opts.threads=threads;
+        assert(se::parallel_visit(
+                   vec.begin(),vec.end(),weighted_value(),plus,opts)==single);
+    }
+
+    auto const count=[](auto const&){ return size_t(1); };
+    assert(se::parallel_visit(vec.data(),vec.data()+vec.size(),count,
+                              std::plus<size_t>())==vec.size());
+    assert(se::parallel_visit(vec.begin(),vec.begin(),count,
+                              std::plus<size_t>())==0);
+}
+
+void parallel_visit_propagates_exceptions(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant<int,double> V;
+    std::vector<V> vec(50000,V(1));
+    vec[43210]=V(2.0);
+    se::parallel_visit_options opts;
+    opts.chunk_size=500;
+    opts.threads=4;
+    bool caught=false;
+    try{
+        se::parallel_visit(
+            vec.begin(),vec.end(),
+            [](auto x)->int{
+                if(std::is_same<decltype(x),double>::value)
+                    throw std::runtime_error("double");
+                return int(x);
+            },
+            std::plus<int>(),opts);
+    }
+    catch(std::runtime_error const&){
+        caught=true;
+    }
+    assert(caught);
+}
+
+struct Sample{
+    int id;
+    float reading;
+};
+
+bool operator==(Sample const& lhs,Sample const& rhs){
+    return lhs.id==rhs.id && lhs.reading==rhs.reading;
+}
+
+void variant_span_round_trip(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant<int,double,Sample> V;
+    std::vector<V> values;
+    values.emplace_back(42);
+    values.emplace_back(3.5);
+    values.emplace_back(Sample{7,1.25f});
+    values.emplace_back(-1);
+    std::ostringstream out;
+    se::write_variant_span(out,values.begin(),values.end());
+    std::string const bytes=out.str();
+    assert((bytes.size()==se::variant_span<int,double,Sample>::bytes_required(4)));
+
+    std::vector<double> buffer(bytes.size()/sizeof(double)+1);
+    memcpy(buffer.data(),bytes.data(),bytes.size());
+    se::variant_span<int,double,Sample> span(buffer.data(),bytes.size());
+    assert(span.size()==4);
+    assert(span.index(0)==0);
+    assert(span.get<0>(0)==42);
+    assert(span.get<double>(1)==3.5);
+    assert(span.get<2>(2).id==7);
+    assert(span.get<Sample>(2).reading==1.25f);
+    assert(span.visit([](auto const& x){ return sizeof(x); },2)==sizeof(Sample));
+    V const loaded=span.load(3);
+    assert(se::get<0>(loaded)==-1);
+    bool caught=false;
+    try{
+        span.get<1>(0);
+    }
+    catch(se::bad_variant_access const&){
+        caught=true;
+    }
+    assert(caught);
+
+    auto const rejects=[&](std::vector<double> const& b,size_t size){
+        try{
+            se::variant_span<int,double,Sample> bad(b.data(),size);
+        }
+        catch(se::variant_span_error const&){
+            return true;
+        }
+        return false;
+    };
+    assert(rejects(buffer,bytes.size()-1));
+    assert(rejects(buffer,10));
+    std::vector<double> corrupt(buffer);
+    size_t const record_size=(bytes.size()-64)/4;
+    // The discriminator of the third record follows its 8 value bytes.
+    reinterpret_cast<unsigned char*>(corrupt.data())[64+2*record_size+8]=7;
+    assert(rejects(corrupt,bytes.size()));
+    try{
+        se::variant_span<int,float,Sample> other(buffer.data(),bytes.size());
+        assert(!"layout mismatch accepted");
+    }
+    catch(se::variant_span_error const&){}
+
+    typedef se::variant<int,int> Twin;
+    std::vector<Twin> twins{Twin(se::in_place<1>,5),Twin(se::in_place<0>,6)};
+    std::ostringstream twin_out;
+    se::write_variant_span(twin_out,twins.begin(),twins.end());
+    std::string const twin_bytes=twin_out.str();
+    std::vector<double> twin_buffer(twin_bytes.size()/sizeof(double)+1);
+    memcpy(twin_buffer.data(),twin_bytes.data(),twin_bytes.size());
+    se::variant_span<int,int> twin_span(twin_buffer.data(),twin_bytes.size());
+    Twin const second=twin_span.load(0);
+    assert(second.index()==1);
+    assert(se::get<1>(second)==5);
+    assert(twin_span.load(1).index()==0);
+}
+
+void variant_channel_round_trip(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant_channel<int,double,Sample> Channel;
+    std::string const name="/jss_variant_test_"+std::to_string(getpid());
+    Channel producer=Channel::create(name.c_str(),3);
+    Channel consumer=Channel::attach(name.c_str());
+    Channel::unlink(name.c_str());
+    assert(producer.capacity()==4);
+
+    auto const next=[&]{
+        std::string seen;
+        struct Describe{
+            std::string& seen;
+            void operator()(Sample const& s){
+                seen="sample:"+std::to_string(s.id);
+            }
+            void operator()(int i){
+                seen="int:"+std::to_string(i);
+            }
+            void operator()(double d){
+                std::ostringstream out;
+                out<<"double:"<<d;
+                seen=out.str();
+            }
+        };
+        bool const got=consumer.try_visit(Describe{seen});
+        return got?seen:std::string("empty");
+    };
+    assert(next()=="empty");
+    assert(producer.try_emplace<0>(42));
+    assert(producer.try_emplace<double>(3.5));
+    assert(producer.try_emplace<int>(7));
+    assert(producer.try_emplace<0>(8));
+    assert(!producer.try_emplace<0>(9));
+    assert(next()=="int:42");
+    assert(next()=="double:3.5");
+    assert(producer.try_emplace<0>(9));
+    assert(next()=="int:7");
+    assert(next()=="int:8");
+    assert(next()=="int:9");
+    assert(next()=="empty");
+
+    producer.emplace<2>(Sample{5,0.5f});
+    assert(next()=="sample:5");
+
+    std::string const other_name=name+"_other";
+    se::variant_channel<int,float,Sample> other=
+        se::variant_channel<int,float,Sample>::create(other_name.c_str(),2);
+    bool caught=false;
+    try{
+        Channel::attach(other_name.c_str());
+    }
+    catch(se::variant_channel_error const&){
+        caught=true;
+    }
+    Channel::unlink(other_name.c_str());
+    assert(caught);
+}
+
+void variant_channel_consumer_reattaches(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant_channel<int,double,Sample> Channel;
+    std::string const name="/jss_variant_reattach_"+std::to_string(getpid());
+    Channel producer=Channel::create(name.c_str(),4);
+    for(int i=1;i<=4;++i)
+        producer.emplace<0>(i);
+    auto const next=[](Channel& consumer){
+        struct Take{
+            int& seen;
+            void operator()(int i){ seen=i; }
+            void operator()(double){ seen=-1; }
+            void operator()(Sample const&){ seen=-1; }
+        };
+        int seen=0;
+        consumer.try_visit(Take{seen});
+        return seen;
+    };
+    {
+        Channel first=Channel::attach(name.c_str());
+        assert(next(first)==1);
+    }
+    pid_t const child=fork();
+    if(!child){
+        Channel consumer=Channel::attach(name.c_str());
+        _exit(next(consumer)==2?0:1);
+    }
+    int status=0;
+    assert(waitpid(child,&status,0)==child);
+    assert(WIFEXITED(status) && WEXITSTATUS(status)==0);
+    Channel consumer=Channel::attach(name.c_str());
+    assert(next(consumer)==3);
+    assert(producer.try_emplace<0>(5));
+    assert(producer.try_emplace<0>(6));
+    assert(next(consumer)==4);
+    assert(next(consumer)==5);
+    assert(next(consumer)==6);
+    assert(next(consumer)==0);
+    Channel::unlink(name.c_str());
+}
+
+struct CheckedSample{
+    int id;
+    explicit CheckedSample(int id_):
+        id(id_){
+        if(id<0)
+            throw std::invalid_argument("negative id");
+    }
+};
+
+void variant_channel_survives_throwing_emplace(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant_channel<int,CheckedSample> Channel;
+    std::string const name="/jss_variant_throwing_"+std::to_string(getpid());
+    Channel channel=Channel::create(name.c_str(),2);
+    Channel::unlink(name.c_str());
+    bool caught=false;
+    try{
+        channel.try_emplace<1>(-1);
+    }
+    catch(std::invalid_argument const&){
+        caught=true;
+    }
+    assert(caught);
+    assert(channel.try_emplace<1>(3));
+    int seen=0;
+    struct Take{
+        int& seen;
+        void operator()(int){ seen=-1; }
+        void operator()(CheckedSample const& s){ seen=s.id; }
+    };
+    assert(channel.try_visit(Take{seen}));
+    assert(seen==3);
+    assert(!channel.try_visit(Take{seen}));
+}
+
+struct OwnedSample{
+    int id;
+    explicit OwnedSample(std::unique_ptr<int> p){
+        if(!p)
+            throw std::invalid_argument("no id");
+        id=*p;
+    }
+};
+
+void variant_channel_emplace_waits_without_reconstructing(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant_channel<int,OwnedSample> Channel;
+    std::string const name="/jss_variant_waiting_"+std::to_string(getpid());
+    Channel channel=Channel::create(name.c_str(),2);
+    Channel::unlink(name.c_str());
+    assert(channel.try_emplace<0>(1));
+    assert(channel.try_emplace<0>(2));
+    std::vector<int> seen;
+    struct Take{
+        std::vector<int>& seen;
+        void operator()(int i){ seen.push_back(i); }
+        void operator()(OwnedSample const& s){ seen.push_back(s.id); }
+    };
+    std::thread consumer([&]{
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        assert(channel.try_visit(Take{seen}));
+    });
+    channel.emplace<1>(std::unique_ptr<int>(new int(7)));
+    consumer.join();
+    while(channel.try_visit(Take{seen}))
+        ;
+    assert((seen==std::vector<int>{1,2,7}));
+}
+
+void variant_columns_round_trip(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant<long,double,Sample,std::string> V;
+    std::vector<V> values;
+    for(long i=0;i<100;++i)
+        values.emplace_back(1000+i*3);
+    for(int i=0;i<20;++i){
+        values.emplace_back(i%3?0.5:1.5);
+        values.emplace_back(Sample{i,float(i)});
+        values.emplace_back(std::string(size_t(i),'x'));
+    }
+    values.emplace_back(-5L);
+    std::ostringstream out;
+    se::write_variant_columns(out,values.begin(),values.end());
+    std::string const bytes=out.str();
+
+    se::variant_columns<long,double,Sample,std::string> columns(bytes.data(),bytes.size());
+    assert(columns.size()==values.size());
+    assert(columns.count(0)==101);
+    assert(columns.encoding(0)==se::column_encoding::delta);
+    assert(columns.encoding(1)==se::column_encoding::dictionary);
+    assert(columns.encoding(3)==se::column_encoding::codec);
+    std::vector<V> decoded;
+    columns.decode(std::back_inserter(decoded));
+    assert(decoded==values);
+    std::vector<ptrdiff_t> const indices=columns.indices();
+    for(size_t i=0;i<values.size();++i)
+        assert(indices[i]==values[i].index());
+    std::vector<long> const longs=columns.column<0>();
+    assert(longs.size()==101 && longs[99]==1297 && longs[100]==-5);
+    assert(columns.column<std::string>()[7]=="xxxxxxx");
+
+    // Projection reads only the one column, so damage elsewhere goes
+    // unnoticed until the damaged column is decoded.
+    std::string damaged(bytes);
+    uint64_t string_column;
+    memcpy(&string_column,bytes.data()+48+3*32,sizeof(string_column));
+    damaged[string_column]='\x7f';
+    se::variant_columns<long,double,Sample,std::string> partial(
+        damaged.data(),damaged.size());
+    assert(partial.column<0>()==longs);
+    bool caught=false;
+    try{
+        partial.column<3>();
+    }
+    catch(se::variant_columns_error const&){
+        caught=true;
+    }
+    assert(caught);
+
+    caught=false;
+    try{
+        se::variant_columns<long,float,Sample,std::string> other(bytes.data(),bytes.size());
+    }
+    catch(se::variant_columns_error const&){
+        caught=true;
+    }
+    assert(caught);
+    caught=false;
+    try{
+        se::variant_columns<long,double,Sample,std::string> truncated(
+            bytes.data(),bytes.size()-1);
+    }
+    catch(se::variant_columns_error const&){
+        caught=true;
+    }
+    assert(caught);
+}
+
+struct MoveCounted{
+    static int moves;
+    int values[64];
+    explicit MoveCounted(int x){
+        values[0]=x;
+    }
+    MoveCounted(MoveCounted&& other){
+        ++moves;
+        values[0]=other.values[0];
+    }
+    MoveCounted(MoveCounted const&)=delete;
+};
+
+int MoveCounted::moves=0;
+
+MoveCounted make_move_counted(int x){
+    return MoveCounted(x);
+}
+
+void emplace_with_constructs_from_factory_result(){
+    std::cout<<__FUNCTION__<<std::endl;
+    MoveCounted::moves=0;
+    se::variant<int,MoveCounted,std::string> v(
+        se::in_place_factory,se::in_place<1>,[]{ return make_move_counted(3); });
+    assert(v.index()==1);
+    assert(se::get<1>(v).values[0]==3);
+    v.emplace_with<0>([]{ return 42; });
+    assert(se::get<0>(v)==42);
+    v.emplace_with<MoveCounted>([]{ return make_move_counted(5); });
+    assert(se::get<MoveCounted>(v).values[0]==5);
+    v.emplace_with<2>([]{ return std::string("built"); });
+    assert(se::get<2>(v)=="built");
+    assert(MoveCounted::moves==0);
+
+    // A factory returning a reference would have its result copied, so
+    // this fails with "Factory must return the alternative by value":
+    //
+    //   static std::string const text("text");
+    //   v.emplace_with<2>([]()->std::string const&{ return text; });
+
+    se::variant<int,std::string> w(
+        se::in_place_factory,se::in_place<std::string>,[]{ return std::string(3,'z'); });
+    assert(se::get<1>(w)=="zzz");
+    try{
+        w.emplace_with<0>([]()->int{ throw std::runtime_error("factory"); });
+        assert(!"factory exception swallowed");
+    }
+    catch(std::runtime_error const&){}
+    assert(w.valueless_by_exception());
+}
+
+size_t describe_length(se::variant_cref<int,std::string,double> value){
+    return se::visit([](auto const& x){ return sizeof(x); },value);
+}
+
+void variant_ref_views_alternatives_without_copying(){
+    std::cout<<__FUNCTION__<<std::endl;
+    std::string text("hello");
+    se::variant_ref<int,std::string,double> r(text);
+    assert(r.index()==1);
+    assert(&se::get<1>(r)==&text);
+    se::get<std::string>(r)+=" world";
+    assert(text=="hello world");
+    assert(se::holds_alternative<std::string>(r));
+    assert(se::get_if<0>(r)==nullptr);
+    assert(se::get_if<1>(r)==&text);
+    bool caught=false;
+    try{
+        se::get<0>(r);
+    }
+    catch(se::bad_variant_access const&){
+        caught=true;
+    }
+    assert(caught);
+    se::visit([](auto& x){ x+=x; },r);
+    assert(text=="hello worldhello world");
+
+    // A variant whose alternatives are among the view's.
+    se::variant<double,int> v(2.5);
+    se::variant_ref<int,std::string,double> rv(v);
+    assert(rv.index()==2);
+    assert(&se::get<double>(rv)==&se::get<0>(v));
+    se::get<2>(rv)=4.0;
+    assert(se::get<0>(v)==4.0);
+
+    // A variant with alternatives the view does not have.
+    se::variant<char,std::string,float> wide(std::string("wide"));
+    se::variant_ref<int,std::string,double> rw(wide);
+    assert(rw.index()==1);
+    assert(&se::get<1>(rw)==&se::get<1>(wide));
+    se::variant_cref<int,std::string,double> cw(wide);
+    assert(&se::get<std::string>(cw)==&se::get<1>(wide));
+    wide='c';
+    caught=false;
+    try{
+        se::variant_ref<int,std::string,double> outside(wide);
+    }
+    catch(se::bad_variant_access const&){
+        caught=true;
+    }
+    assert(caught);
+    caught=false;
+    try{
+        se::variant_cref<int,std::string,double> outside(wide);
+    }
+    catch(se::bad_variant_access const&){
+        caught=true;
+    }
+    assert(caught);
+    static_assert(!std::is_constructible<
+                  se::variant_ref<int,std::string,double>,
+                  se::variant<char,float>&>::value,"");
+
+    se::variant<int,std::string,double> const same(std::string("abc"));
+    se::variant_cref<int,std::string,double> c(same);
+    assert(c.index()==1 && &se::get<1>(c)==&se::get<1>(same));
+    assert(describe_length(42)==sizeof(int));
+    assert(describe_length(text)==sizeof(std::string));
+    assert(describe_length(v)==sizeof(double));
+    assert(describe_length(r)==sizeof(std::string));
+
+    se::variant<int,double> empty(1);
+    try{
+        empty.emplace<1>([]()->double{ throw std::runtime_error("empty"); }());
+    }
+    catch(std::runtime_error const&){}
+    caught=false;
+    try{
+        se::variant_ref<int,std::string,double> bad(empty);
+    }
+    catch(se::bad_variant_access const&){
+        caught=true;
+    }
+    assert(caught==empty.valueless_by_exception());
+}
+
+// Constant evaluation of emplace, assignment and swap needs the
+// compiler to say when it is evaluating a constant expression. The
+// table is kept small to stay within the default evaluation limits;
+// "make constexpr" checks one of 100,000 entries, and fails to build
+// without such a compiler.
+#ifdef _JSS_VARIANT_IS_CONSTANT_EVALUATED
+typedef se::variant<int,double,char> LookupEntry;
+
+constexpr int lookup_table_size=1000;
+
+// Built in place by its constructor: returning the table from a
+// function would copy every entry during constant evaluation.
+struct LookupTable{
+    LookupEntry entries[lookup_table_size];
+
+    constexpr LookupTable():
+        entries{}
+    {
+        for(int i=0;i<lookup_table_size;++i){
+            switch(i%3){
+            case 0: entries[i].emplace<0>(i); break;
+            case 1: entries[i].emplace<1>(i*0.5); break;
+            default: entries[i].emplace<char>(char('a'+i%26)); break;
+            }
+        }
+        LookupEntry first=entries[0];
+        first=entries[2];
+        entries[0].swap(entries[1]);
+        entries[lookup_table_size-1]=first;
+        entries[lookup_table_size-2]=2.5;
+    }
+};
+
+// Constant-initialized: a dynamic initializer would make this
+// declaration ill-formed.
+constexpr LookupTable lookup_table{};
+
+struct EntrySize{
+    template<typename T>
+    constexpr size_t operator()(T const&) const{
+        return sizeof(T);
+    }
+};
+
+static_assert(lookup_table.entries[0].index()==1,"");
+static_assert(se::get<1>(lookup_table.entries[0])==0.5,"");
+static_assert(se::get<0>(lookup_table.entries[1])==0,"");
+static_assert(se::get<char>(lookup_table.entries[5])=='f',"");
+static_assert(lookup_table.entries[lookup_table_size-1]==LookupEntry('c'),"");
+static_assert(
+    se::get<double>(lookup_table.entries[lookup_table_size-2])==2.5,"");
+static_assert(lookup_table.entries[3]<lookup_table.entries[4],"");
+static_assert(se::visit(EntrySize(),lookup_table.entries[7])==sizeof(double),"");
+
+void constexpr_lookup_table(){
+    std::cout<<__FUNCTION__<<std::endl;
+    size_t count=0;
+    for(LookupEntry const& entry:lookup_table.entries)
+        count+=(entry.index()==0);
+    assert(count==333);
+    assert(se::get<0>(lookup_table.entries[99])==99);
+}
+#endif
+
+JSS_VARIANT_INSTANTIATE(long,std::string);
+
+void explicitly_instantiated_variant(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant<long,std::string> V;
+    V v(std::string("hello"));
+    V w(v);
+    assert(se::get<1>(w)=="hello");
+    w=42L;
+    swap(v,w);
+    assert(se::get<0>(v)==42);
+    assert(se::get<1>(w)=="hello");
+    V x(std::move(w));
+    assert(se::get<1>(x)=="hello");
+    v=x;
+    assert(v==x);
+}
+
+void dormant_buffer_reused_by_next_construction(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant<std::vector<char>,long,double> Field;
+    Field f(std::vector<char>(1000,'a'));
+    char const* const buffer=se::get<0>(f).data();
+    f=3L;
+    std::vector<char> const text(10,'b');
+    f=text;
+    assert(se::get<0>(f)==text);
+    assert(se::get<0>(f).data()==buffer);
+    f=2.5;
+    std::vector<char> mutable_text(15,'e');
+    f=mutable_text;
+    assert(se::get<0>(f)==mutable_text);
+    assert(se::get<0>(f).data()==buffer);
+    f=2.5;
+    f.emplace<0>(size_t(20),'c');
+    assert(se::get<0>(f)==std::vector<char>(20,'c'));
+    assert(se::get<0>(f).data()==buffer);
+
+    Field g(1L);
+    f=1L;
+    g.emplace<std::vector<char>>(size_t(5),'d');
+    assert(se::get<0>(g).data()==buffer);
+    assert(se::get<0>(g).size()==5);
+    assert(se::get<1>(f)==1L);
+
+    g=1L;
+    assert(se::release_dormant_buffers<std::vector<char>>()==1);
+    assert(se::release_dormant_buffers<std::vector<char>>()==0);
+
+    typedef std::vector<unsigned char> Bytes;
+    typedef se::variant<Bytes,long> Bounded;
+    Bounded small(Bytes(32,1));
+    Bounded large(Bytes(1000,2));
+    small=1L;
+    large=2L;
+    assert(se::release_dormant_buffers<Bytes>()==1);
+}
+
+struct ReplacedOnExit{
+    se::variant<std::vector<char>,long> field;
+    bool& replaced;
+    ~ReplacedOnExit(){
+        field.emplace<0>(size_t(2000),'x');
+        field=1L;
+        replaced=(se::release_dormant_buffers<std::vector<char>>()==0);
+    }
+};
+
+void dormant_buffer_not_retained_after_pool_destroyed(){
+    std::cout<<__FUNCTION__<<std::endl;
+    bool replaced=false;
+    std::thread([&]{
+        // Constructed before the pool, so destroyed after it.
+        thread_local ReplacedOnExit holder{std::vector<char>(1000,'a'),replaced};
+        holder.field=2L;
+        assert(se::release_dormant_buffers<std::vector<char>>()==1);
+    }).join();
+    assert(replaced);
+}
+
+void deferred_destruction_until_drained(){
+    std::cout<<__FUNCTION__<<std::endl;
+    se::variant_reclaim_queue& queue=se::variant_reclaim_queue::local();
+    assert(queue.size()==0);
+    std::weak_ptr<int> replaced,destroyed;
+    {
+        se::variant<int,Deferred> v(Deferred{std::make_shared<int>(1)});
+        replaced=se::get<1>(v).resource;
+        v=42;
+        assert(!replaced.expired());
+        v=Deferred{std::make_shared<int>(2)};
+        destroyed=se::get<1>(v).resource;
+    }
+    assert(!replaced.expired());
+    assert(!destroyed.expired());
+    assert(queue.size()==2);
+    assert(queue.drain()==2);
+    assert(replaced.expired());
+    assert(destroyed.expired());
+
+    se::variant_reclaimer reclaimer;
+    {
+        se::variant<int,Deferred> v(Deferred{std::make_shared<int>(3)});
+        destroyed=se::get<1>(v).resource;
+    }
+    assert(queue.size()==1);
+    queue.hand_off();
+    assert(queue.size()==0);
+    while(!destroyed.expired())
+        std::this_thread::yield();
+}
+
+void deferred_destruction_of_same_index_assignment(){
+    std::cout<<__FUNCTION__<<std::endl;
+    se::variant_reclaim_queue& queue=se::variant_reclaim_queue::local();
+    std::weak_ptr<int> first,second,third;
+    {
+        se::variant<int,Deferred> v(Deferred{std::make_shared<int>(1)});
+        first=se::get<1>(v).resource;
+        v=Deferred{std::make_shared<int>(2)};
+        assert(!first.expired());
+        assert(queue.size()==1);
+        second=se::get<1>(v).resource;
+        Deferred const d{std::make_shared<int>(3)};
+        v=d;
+        assert(!second.expired());
+        assert(queue.size()==2);
+        se::variant<int,Deferred> w(Deferred{std::make_shared<int>(4)});
+        v=w;
+        v=std::move(w);
+        assert(queue.size()==4);
+        v=v;
+        assert(queue.size()==5);
+        third=se::get<1>(v).resource;
+        assert(*third.lock()==4);
+        assert(queue.drain()==5);
+        assert(first.expired());
+        assert(second.expired());
+        assert(!third.expired());
+    }
+    assert(queue.drain()==1);
+    assert(third.expired());
+}
+
+void deferred_destruction_of_nested_alternatives(){
+    std::cout<<__FUNCTION__<<std::endl;
+    se::variant_reclaim_queue& queue=se::variant_reclaim_queue::local();
+    std::weak_ptr<int> parent,child;
+    {
+        DeferredNode node{std::make_shared<int>(1),nullptr};
+        node.child.reset(new se::variant<int,DeferredNode>(
+                             DeferredNode{std::make_shared<int>(2),nullptr}));
+        parent=node.resource;
+        child=se::get<1>(*node.child).resource;
+        se::variant<int,DeferredNode> v(std::move(node));
+    }
+    assert(queue.size()==1);
+    assert(!child.expired());
+    assert(queue.drain()==2);
+    assert(queue.size()==0);
+    assert(parent.expired());
+    assert(child.expired());
+}
+
+void deferred_destruction_after_queue_destroyed(){
+    std::cout<<__FUNCTION__<<std::endl;
+    std::weak_ptr<int> destroyed;
+    std::thread([&]{
+        // Constructed before the queue, so destroyed after it.
+        thread_local se::variant<int,Deferred> v(
+            Deferred{std::make_shared<int>(1)});
+        destroyed=se::get<1>(v).resource;
+        assert(se::variant_reclaim_queue::local().size()==0);
+    }).join();
+    assert(destroyed.expired());
+}
+
+void cow_alternative_shares_until_written(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant<int,se::cow<std::vector<int>>> Message;
+    Message const original(std::vector<int>(1000,7));
+    Message copy(original);
+    Message third(original);
+    se::cow<std::vector<int>> const& shared=se::get<1>(original);
+    assert(shared.use_count()==3);
+    assert(&*se::get<1>(copy)==&*shared);
+    assert(copy==original);
+
+    se::get<1>(copy).write()[0]=8;
+    assert(shared.use_count()==2);
+    assert(se::get<1>(copy).unique());
+    assert((*shared)[0]==7);
+    assert((*se::get<1>(copy))[0]==8);
+    assert(copy!=original);
+    assert(original<copy);
+
+    third=42;
+    assert(shared.unique());
+    se::get<1>(copy).write()[1]=9;
+    assert((*se::get<1>(copy))[1]==9);
+
+    se::cow<std::string,se::cow_single_thread> text=
+        se::make_cow<std::string,se::cow_single_thread>(3,'x');
+    se::cow<std::string,se::cow_single_thread> text_copy(text);
+    assert(text.use_count()==2);
+    text_copy.write()+="y";
+    assert(*text=="xxx");
+    assert(*text_copy=="xxxy");
+}
+
+typedef se::variant_layout_report<se::variant<char,double,int&>> SmallLayout;
+static_assert(SmallLayout::alternatives==3,"");
+static_assert(SmallLayout::storage_size==sizeof(double),"");
+static_assert(SmallLayout::discriminator_size==1,"");
+static_assert(SmallLayout::size==
+              SmallLayout::storage_size+SmallLayout::discriminator_size+
+              SmallLayout::padding,"");
+static_assert(!SmallLayout::backup_storage_required,"");
+static_assert(SmallLayout::alternative_size[2]==sizeof(int*),"");
+static_assert(SmallLayout::largest_alternative()==1,"");
+
+void layout_report_describes_alternatives(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant_layout_report<
+        se::variant<int,std::string,ThrowingCopy,CopyError>> Layout;
+    static_assert(!Layout::nothrow_move_constructible,"");
+    assert(Layout::trivially_copyable[0]);
+    assert(!Layout::trivially_copyable[1]);
+    assert(!Layout::trivially_destructible[1]);
+    assert(Layout::trivially_destructible[3]);
+    assert(Layout::alternative_size[1]==sizeof(std::string));
+    assert(Layout::alternative_alignment[1]==alignof(std::string));
+    assert(Layout::largest_alternative()==1);
+    size_t nothrow_moves=0;
+    for(bool nothrow:Layout::alternative_nothrow_move_constructible)
+        nothrow_moves+=nothrow;
+    assert(nothrow_moves==3);
+    assert(!Layout::alternative_nothrow_move_constructible[2]);
+}
+
+struct RunRecorder{
+    std::vector<std::pair<size_t,ptrdiff_t>> runs;
+    std::string text;
+
+    template<ptrdiff_t I,typename It>
+    void operator()(se::alternative_run<I,It> const& run){
+        runs.emplace_back(run.index,run.size());
+        for(auto& value:run)
+            append(value);
+    }
+
+    void append(int i){ text+=std::to_string(i); }
+    void append(std::string const& s){ text+=s; }
+};
+
+void visit_runs_dispatches_once_per_run(){
+    std::cout<<__FUNCTION__<<std::endl;
+    typedef se::variant<int,std::string> V;
+    std::vector<V> vec{
+        V(1),V(2),V(3),V("a"),V("b"),V(4),V("c"),V("d"),V("e"),V("f")};
+    RunRecorder const recorder=se::visit_runs(
+        vec.cbegin(),vec.cend(),RunRecorder());
+    typedef std::pair<size_t,ptrdiff_t> Run;
+    assert((recorder.runs==std::vector<Run>{
+                Run(0,3),Run(1,2),Run(0,1),Run(1,4)}));
+    assert(recorder.text=="123ab4cdef");
+
+    se::visit_runs(vec.begin(),vec.begin(),[](auto const&){ assert(false); });
+
+    se::visit_runs(vec.data(),vec.data()+vec.size(),[](auto const& run){
+        auto const first=run.front();
+        for(auto& value:run)
+            value=first;
+    });
+    assert(se::get<0>(vec[2])==1);
+    assert(se::get<1>(vec[4])=="a");
+    assert(se::get<0>(vec[5])==4);
+    assert(se::get<1>(vec[9])=="c");
+}
+
 int main(){
     initial_is_first_type();
     can_construct_first_type();
@@ -2033,4 +3533,44 @@ int main(){
     allocator_move_constructor_no_allocator_support();
     allocator_move_constructor_allocator_arg_support();
     allocator_move_constructor_no_allocator_arg_support();
+    count_and_find_alternative();
+    partition_by_alternative();
+    holds_any_of();
+    variant_cast_widening();
+    try_variant_cast_narrowing();
+    cross_variant_equality();
+    visit_indexed();
+    visit_with_explicit_return_type();
+    shared_variant_load_and_store();
+    shared_variant_concurrent_readers();
+    destroy_range();
+    trivial_alternatives_copied_bitwise();
+    bitwise_equality_and_hash();
+    special_members_beyond_eight_alternatives();
+    dispatcher_routes_by_alternative();
+    dispatcher_applies_backpressure();
+    dispatcher_skips_value_that_failed_to_copy();
+    parallel_visit_reduces_deterministically();
+    parallel_visit_propagates_exceptions();
+    variant_span_round_trip();
+    variant_channel_round_trip();
+    variant_channel_consumer_reattaches();
+    variant_channel_survives_throwing_emplace();
+    variant_channel_emplace_waits_without_reconstructing();
+    variant_columns_round_trip();
+    emplace_with_constructs_from_factory_result();
+    variant_ref_views_alternatives_without_copying();
+#ifdef _JSS_VARIANT_IS_CONSTANT_EVALUATED
+    constexpr_lookup_table();
+#endif
+    explicitly_instantiated_variant();
+    dormant_buffer_reused_by_next_construction();
+    dormant_buffer_not_retained_after_pool_destroyed();
+    deferred_destruction_until_drained();
+    deferred_destruction_of_same_index_assignment();
+    deferred_destruction_of_nested_alternatives();
+    deferred_destruction_after_queue_destroyed();
+    cow_alternative_shares_until_written();
+    layout_report_describes_alternatives();
+    visit_runs_dispatches_once_per_run();
 }
@@ -0,0 +1,69 @@
+// -*- C++ -*-
+// Copyright (c) 2015, Just Software Solutions Ltd
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or
+// without modification, are permitted provided that the
+// following conditions are met:
+//
+// 1. Redistributions of source code must retain the above
+// copyright notice, this list of conditions and the following
+// disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following
+// disclaimer in the documentation and/or other materials
+// provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of
+// its contributors may be used to endorse or promote products
+// derived from this software without specific prior written
+// permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Experimental module interface unit for the variant header, for
+// compilers with C++20 module support, e.g.
+//
+//   g++ -std=c++20 -fmodules-ts -c variant.cppm
+//
+// and then `import jss.variant;`, as module_variant.cpp does; "make
+// module" builds and runs that. Macros such as
+// JSS_VARIANT_EXTERN_TEMPLATE are not exported, and with g++ 12 a
+// std::string alternative used in an importer hits an internal
+// compiler error, so this does not yet replace the header.
+// The header is parsed once, when the interface is compiled, and the
+// importers load its compiled form. The standard headers it uses are
+// included in the global module fragment so that they are not
+// attached to the module; g++ 12 additionally needs importers to
+// include <new> themselves before the import.
+module;
+#include <stddef.h>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <new>
+#include <utility>
+#include <limits.h>
+#include <memory>
+#include <iterator>
+#include <string.h>
+#include <functional>
+
+export module jss.variant;
+
+export{
+#include "variant"
+}